@@ -0,0 +1,89 @@
+/*
+ * batch_means.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <limits>
+
+#include "batch_means.h"
+
+void BatchMeans::init(const std::vector<double> &percentiles, int batchSize)
+{
+    this->percentiles = percentiles;
+    this->batchSize = std::max(2, batchSize);
+    batch.clear();
+    batch.reserve(this->batchSize);
+    est.assign(1 + percentiles.size(), std::vector<double>());
+    samples = 0;
+}
+
+void BatchMeans::add(double value)
+{
+    samples++;
+    batch.push_back(value);
+    if((int)batch.size() < batchSize)
+        return;
+
+    double sum = 0;
+    for(double v : batch)
+        sum += v;
+    est[0].push_back(sum/batch.size());
+    for(size_t p = 0; p < percentiles.size(); p++) {
+        size_t k = std::min(batch.size()-1, (size_t)floor(percentiles[p]*batch.size()));
+        std::nth_element(batch.begin(), batch.begin()+k, batch.end());
+        est[p+1].push_back(batch[k]);
+    }
+    batch.clear();
+}
+
+std::string BatchMeans::getEstimateName(int i) const
+{
+    if(i == 0)
+        return "mean";
+    char buf[32];
+    snprintf(buf, sizeof(buf), "p%g", 100*percentiles[i-1]);
+    return buf;
+}
+
+double BatchMeans::getEstimate(int i) const
+{
+    const std::vector<double> &b = est[i];
+    if(b.empty())
+        return 0;
+    double sum = 0;
+    for(double v : b)
+        sum += v;
+    return sum/b.size();
+}
+
+double BatchMeans::getRelHalfWidth(int i) const
+{
+    const std::vector<double> &b = est[i];
+    int k = b.size();
+    if(k < 2)
+        return std::numeric_limits<double>::infinity();
+    double mean = getEstimate(i);
+    double ss = 0;
+    for(double v : b)
+        ss += (v-mean)*(v-mean);
+    double sd = sqrt(ss/(k-1));
+
+    // Student t quantile for 95% two-sided, Cornish-Fisher expansion around z = 1.96
+    double z = 1.959964, df = k-1;
+    double t = z + (z*z*z + z)/(4*df) + (5*pow(z,5) + 16*z*z*z + 3*z)/(96*df*df);
+    double hw = t*sd/sqrt((double)k);
+    return (mean != 0) ? hw/fabs(mean) : std::numeric_limits<double>::infinity();
+}
+
+double BatchMeans::getMaxRelHalfWidth() const
+{
+    double worst = 0;
+    for(int i = 0; i < getNumEstimates(); i++)
+        worst = std::max(worst, getRelHalfWidth(i));
+    return worst;
+}
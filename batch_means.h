@@ -0,0 +1,41 @@
+/*
+ * batch_means.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef BATCH_MEANS_H_
+#define BATCH_MEANS_H_
+
+#include <string>
+#include <vector>
+
+/*
+ * Batch-means confidence intervals for the mean and a set of percentiles of one latency series.
+ * Samples are grouped into batches of batchSize; every batch contributes its mean and its
+ * percentiles as one (approximately independent) observation. The 95% CI half-width of each
+ * estimate is t(k-1) * s / sqrt(k) over the k completed batches.
+ */
+class BatchMeans
+{
+    private:
+        std::vector<double> percentiles;        // requested percentiles in (0,1)
+        int batchSize = 1000;
+        std::vector<double> batch;              // samples of the current batch
+        std::vector<std::vector<double>> est;   // per estimate (mean, then percentiles): one value per batch
+        long samples = 0;
+
+    public:
+        void init(const std::vector<double> &percentiles, int batchSize);
+        void add(double value);
+        long getSamples() const { return samples; }
+        int getBatches() const { return est.empty() ? 0 : (int)est[0].size(); }
+        int getNumEstimates() const { return (int)est.size(); }
+        std::string getEstimateName(int i) const;
+        double getEstimate(int i) const;        // grand mean of the batch values
+        double getRelHalfWidth(int i) const;    // CI half-width relative to the estimate
+        double getMaxRelHalfWidth() const;      // worst relative half-width over all estimates
+};
+
+#endif /* BATCH_MEANS_H_ */
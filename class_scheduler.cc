@@ -0,0 +1,175 @@
+/*
+ * class_scheduler.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+#include "class_scheduler.h"
+
+using namespace std;
+using namespace omnetpp;
+
+const char *ClassScheduler::class_names[ClassScheduler::num_classes] = {"xr", "hmd", "ctrl", "hptc"};
+
+void ClassScheduler::init(const char *name, const char *policy_name, const char *weights, double quantum)
+{
+    if(strcmp(policy_name,"fifo") == 0)
+        policy = FIFO;
+    else if(strcmp(policy_name,"sp") == 0)
+        policy = SP;
+    else if(strcmp(policy_name,"wrr") == 0)
+        policy = WRR;
+    else if(strcmp(policy_name,"drr") == 0)
+        policy = DRR;
+    else
+        throw cRuntimeError("unknown class scheduler '%s' (fifo, sp, wrr, drr)", policy_name);
+
+    vector<double> w = cStringTokenizer(weights).asDoubleVector();
+    if((int)w.size() != num_classes)
+        throw cRuntimeError("class scheduler weights '%s': expected %d values (xr hmd ctrl hptc)", weights, num_classes);
+    for(int c = 0; c < num_classes; c++) {
+        if(w[c] <= 0)
+            throw cRuntimeError("class scheduler weights '%s': every weight must be positive", weights);
+        if((policy == WRR)&&((w[c] < 1)||(w[c] != floor(w[c]))))     // a turn must allow at least one whole packet
+            throw cRuntimeError("class scheduler weights '%s': wrr weights are packets per turn, whole numbers >= 1", weights);
+        weight[c] = w[c];
+    }
+    if((policy == DRR)&&(quantum <= 0))
+        throw cRuntimeError("class scheduler quantum %g: drr needs a positive quantum", quantum);
+    this->quantum = quantum;
+
+    if(policy == FIFO) {
+        queues[0].setName(name);
+    }
+    else {
+        for(int c = 0; c < num_classes; c++)
+            queues[c].setName((string(name) + "." + class_names[c]).c_str());
+    }
+    current = 0;
+    credit[0] = (policy == WRR) ? weight[0] : weight[0]*quantum;
+}
+
+int ClassScheduler::classOf(const char *name) const
+{
+    if(policy == FIFO)
+        return 0;
+    if(strcmp(name,"hmd_data") == 0)
+        return 1;
+    else if(strcmp(name,"control_data") == 0)
+        return 2;
+    else if(strcmp(name,"haptic_data") == 0)
+        return 3;
+    return 0;                                   // xr_data
+}
+
+void ClassScheduler::nextTurn()
+{
+    current = (current + 1) % num_classes;
+    if(policy == WRR)
+        credit[current] = weight[current];
+    else
+        credit[current] += weight[current]*quantum;
+}
+
+int ClassScheduler::select()
+{
+    if(length == 0)
+        return -1;
+    if(policy == FIFO)
+        return 0;
+    if(policy == SP) {
+        for(int c = num_classes-1; c >= 0; c--) {
+            if(!queues[c].isEmpty())
+                return c;
+        }
+        return -1;
+    }
+    while(true) {           // every class earns credit each round, so a backlogged class is reached
+        if(queues[current].isEmpty()) {
+            credit[current] = 0;                // an idle class does not save up credit
+            nextTurn();
+        }
+        else if(policy == WRR) {
+            if(credit[current] >= 1)
+                return current;
+            nextTurn();
+        }
+        else {
+            if(((ethPacket *)queues[current].front())->getByteLength() <= credit[current])
+                return current;
+            nextTurn();
+        }
+    }
+}
+
+void ClassScheduler::insert(ethPacket *pkt)
+{
+    queues[classOf(pkt->getName())].insert(pkt);
+    length++;
+}
+
+ethPacket *ClassScheduler::front()
+{
+    int c = select();
+    return (c < 0) ? nullptr : (ethPacket *)queues[c].front();
+}
+
+ethPacket *ClassScheduler::pop()
+{
+    int c = select();
+    if(c < 0)
+        return nullptr;
+    ethPacket *pkt = (ethPacket *)queues[c].pop();
+    length--;
+    sentPackets[c]++;
+    sentBytes[c] += pkt->getByteLength();
+    if(policy == WRR)
+        credit[c] -= 1;
+    else if(policy == DRR)
+        credit[c] -= pkt->getByteLength();
+    return pkt;
+}
+
+void ClassScheduler::pushFront(ethPacket *pkt)
+{
+    int c = classOf(pkt->getName());
+    if(!queues[c].isEmpty())
+        queues[c].insertBefore(queues[c].front(), pkt);
+    else
+        queues[c].insert(pkt);
+    length++;
+    sentPackets[c]--;                           // the packet is not complete yet
+    sentBytes[c] -= pkt->getByteLength();
+    if(policy == WRR)
+        credit[c] += 1;
+    else if(policy == DRR)
+        credit[c] += pkt->getByteLength();
+}
+
+void ClassScheduler::put(Snapshot &snap, const char *key)
+{
+    if(policy == FIFO) {
+        snap.putQueue(key, queues[0]);
+        return;
+    }
+    for(int c = 0; c < num_classes; c++)
+        snap.putQueue((string(key) + "." + class_names[c]).c_str(), queues[c]);
+}
+
+double ClassScheduler::restore(const Snapshot &snap, const char *key)
+{
+    cQueue all;                                 // a snapshot taken with another policy is re-classified
+    double bytes = snap.restoreQueue(key, all);
+    for(int c = 0; c < num_classes; c++)
+        bytes += snap.restoreQueue((string(key) + "." + class_names[c]).c_str(), all);
+    while(!all.isEmpty())
+        insert((ethPacket *)all.pop());
+    return bytes;
+}
@@ -0,0 +1,67 @@
+/*
+ * class_scheduler.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef CLASS_SCHEDULER_H_
+#define CLASS_SCHEDULER_H_
+
+#include <omnetpp.h>
+
+#include "ethPacket_m.h"
+#include "snapshot.h"
+
+using namespace omnetpp;
+
+/*
+ * The T-CONT 2 queue of an ONU or SFU, split into one sub-queue per traffic class (xr, hmd, ctrl, hptc).
+ * front()/pop() hand out the packet the policy sends next when the T-CONT grant is spent:
+ *   fifo  one queue in arrival order, as before the split
+ *   sp    strict priority hptc > ctrl > hmd > xr
+ *   wrr   weighted round robin, a class sends up to weight packets per turn
+ *   drr   deficit round robin, a class earns weight x quantum bytes per turn
+ * front() only looks, so it may be called any number of times before pop(). When a grant ends inside
+ * a packet the caller pops it, sends a fragment and hands the remainder back with pushFront(); the
+ * remainder goes to the head of its class and the policy is charged only for the bytes that were sent.
+ */
+class ClassScheduler
+{
+    public:
+        static const int num_classes = 4;
+        static const char *class_names[num_classes];
+
+    private:
+        enum Policy { FIFO, SP, WRR, DRR };
+        Policy policy = FIFO;
+        cQueue queues[num_classes];
+        double weight[num_classes] = {1, 1, 1, 1};
+        double credit[num_classes] = {};        // wrr: packets left in the turn, drr: deficit (B)
+        double quantum = 1500;                  // drr bytes per turn and unit weight
+        int current = 0;                        // wrr/drr: class holding the turn
+        int length = 0;
+
+        int select();                           // class of the next packet, -1 if all are empty
+        void nextTurn();
+
+    public:
+        long sentPackets[num_classes] = {};
+        double sentBytes[num_classes] = {};
+
+        void init(const char *name, const char *policy, const char *weights, double quantum);
+        int classOf(const char *name) const;
+        bool isFifo() const { return policy == FIFO; }
+
+        void insert(ethPacket *pkt);
+        ethPacket *front();
+        ethPacket *pop();
+        void pushFront(ethPacket *pkt);
+        bool isEmpty() const { return length == 0; }
+        int getLength() const { return length; }
+
+        void put(Snapshot &snap, const char *key);
+        double restore(const Snapshot &snap, const char *key);     // returns the restored bytes
+};
+
+#endif /* CLASS_SCHEDULER_H_ */
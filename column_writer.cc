@@ -0,0 +1,120 @@
+/*
+ * column_writer.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef FTTR_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include "column_writer.h"
+
+static size_t type_width(char t)
+{
+    switch(t) {
+        case 'd': return 8;
+        case 'f': case 'i': return 4;
+        default: return 1;
+    }
+}
+
+bool ColumnWriter::open(const std::string &path, const std::vector<std::string> &names, const std::string &types,
+                        size_t blockRows, bool compress)
+{
+    close();
+    f = fopen(path.c_str(), "wb");
+    if(f == nullptr)
+        return false;
+    iobuf.resize(4 << 20);
+    setvbuf(f, iobuf.data(), _IOFBF, iobuf.size());
+
+    this->types = types;
+    this->blockRows = std::max((size_t)1, blockRows);
+#ifdef FTTR_WITH_ZLIB
+    this->compress = compress;
+#else
+    (void)compress;
+    this->compress = false;                 // built without zlib, blocks are stored raw
+#endif
+    rows = 0;
+    totalRows = 0;
+    cols.assign(types.size(), std::vector<char>());
+    for(size_t c = 0; c < types.size(); c++)
+        cols[c].reserve(this->blockRows*type_width(types[c]));
+
+    fwrite("FTTRCOL1", 1, 8, f);
+    uint32_t ncols = types.size();
+    fwrite(&ncols, 4, 1, f);
+    for(size_t c = 0; c < types.size(); c++) {
+        char name[24] = {0};
+        strncpy(name, names[c].c_str(), sizeof(name)-1);
+        fwrite(name, 1, sizeof(name), f);
+        fwrite(&types[c], 1, 1, f);
+    }
+    return true;
+}
+
+void ColumnWriter::put(int col, double value)
+{
+    std::vector<char> &b = cols[col];
+    size_t n = b.size();
+    b.resize(n + type_width(types[col]));
+    switch(types[col]) {
+        case 'd': memcpy(&b[n], &value, 8); break;
+        case 'f': { float v = value; memcpy(&b[n], &v, 4); break; }
+        case 'i': { int32_t v = (int32_t)value; memcpy(&b[n], &v, 4); break; }
+        default: { uint8_t v = (uint8_t)value; b[n] = v; break; }
+    }
+}
+
+void ColumnWriter::endRow()
+{
+    rows++;
+    totalRows++;
+    if(rows >= blockRows)
+        flushBlock();
+}
+
+void ColumnWriter::flushBlock()
+{
+    if(f == nullptr || rows == 0)
+        return;
+    uint32_t nrows = rows;
+    fwrite(&nrows, 4, 1, f);
+    for(auto &b : cols) {
+        uint32_t codec = 0;
+        uint32_t bytes = b.size();
+        const char *data = b.data();
+#ifdef FTTR_WITH_ZLIB
+        std::vector<char> z;
+        if(compress) {
+            uLongf zlen = compressBound(b.size());
+            z.resize(zlen);
+            if(compress2((Bytef *)z.data(), &zlen, (const Bytef *)b.data(), b.size(), 1) == Z_OK && zlen < b.size()) {
+                codec = 1;
+                bytes = zlen;
+                data = z.data();
+            }
+        }
+#endif
+        fwrite(&codec, 4, 1, f);
+        fwrite(&bytes, 4, 1, f);
+        fwrite(data, 1, bytes, f);
+        b.clear();
+    }
+    rows = 0;
+}
+
+void ColumnWriter::close()
+{
+    if(f == nullptr)
+        return;
+    flushBlock();
+    fclose(f);
+    f = nullptr;
+}
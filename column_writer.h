@@ -0,0 +1,56 @@
+/*
+ * column_writer.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef COLUMN_WRITER_H_
+#define COLUMN_WRITER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Binary columnar result file, read back by tools/colreader.py.
+ * Rows are buffered column by column and written as blocks of blockRows rows; every column of a
+ * block is one contiguous little-endian array, deflate-compressed when built with
+ * -DFTTR_WITH_ZLIB and compress is set.
+ *
+ * file:   "FTTRCOL1" | uint32 ncols | ncols x (char name[24], char type) | blocks...
+ * block:  uint32 nrows | ncols x (uint32 codec, uint32 bytes, data)     codec 0 = raw, 1 = zlib
+ * types:  'd' float64, 'f' float32, 'i' int32, 'b' uint8
+ */
+class ColumnWriter
+{
+    private:
+        FILE *f = nullptr;
+        std::string types;
+        std::vector<std::vector<char>> cols;    // current block, one byte buffer per column
+        std::vector<char> iobuf;                // large stdio buffer, blocks go out in few write calls
+        size_t rows = 0;
+        size_t blockRows = 65536;
+        bool compress = false;
+        long totalRows = 0;
+
+        void flushBlock();
+
+    public:
+        ~ColumnWriter() { close(); }
+        bool open(const std::string &path, const std::vector<std::string> &names, const std::string &types,
+                  size_t blockRows, bool compress);
+        bool isOpen() const { return f != nullptr; }
+#ifdef FTTR_WITH_ZLIB
+        static bool canCompress() { return true; }
+#else
+        static bool canCompress() { return false; }
+#endif
+        void put(int col, double value);        // converted to the column type
+        void endRow();
+        void close();
+        long getRows() const { return totalRows; }
+};
+
+#endif /* COLUMN_WRITER_H_ */
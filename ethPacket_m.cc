@@ -180,6 +180,7 @@ void ethPacket::copy(const ethPacket& other)
     this->WapDepartureTime = other.WapDepartureTime;
     this->SfuArrivalTime = other.SfuArrivalTime;
     this->SfuDepartureTime = other.SfuDepartureTime;
+    this->MfuArrivalTime = other.MfuArrivalTime;
     this->OnuArrivalTime = other.OnuArrivalTime;
     this->OnuDepartureTime = other.OnuDepartureTime;
     this->OnuId = other.OnuId;
@@ -187,6 +188,10 @@ void ethPacket::copy(const ethPacket& other)
     this->MfuId = other.MfuId;
     this->TContId = other.TContId;
     this->FragmentCount = other.FragmentCount;
+    this->DeviceId = other.DeviceId;
+    this->SourceId = other.SourceId;
+    this->SeqNo = other.SeqNo;
+    this->MoreFragments = other.MoreFragments;
 }
 
 void ethPacket::parsimPack(omnetpp::cCommBuffer *b) const
@@ -197,6 +202,7 @@ void ethPacket::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->WapDepartureTime);
     doParsimPacking(b,this->SfuArrivalTime);
     doParsimPacking(b,this->SfuDepartureTime);
+    doParsimPacking(b,this->MfuArrivalTime);
     doParsimPacking(b,this->OnuArrivalTime);
     doParsimPacking(b,this->OnuDepartureTime);
     doParsimPacking(b,this->OnuId);
@@ -204,6 +210,10 @@ void ethPacket::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->MfuId);
     doParsimPacking(b,this->TContId);
     doParsimPacking(b,this->FragmentCount);
+    doParsimPacking(b,this->DeviceId);
+    doParsimPacking(b,this->SourceId);
+    doParsimPacking(b,this->SeqNo);
+    doParsimPacking(b,this->MoreFragments);
 }
 
 void ethPacket::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -214,6 +224,7 @@ void ethPacket::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->WapDepartureTime);
     doParsimUnpacking(b,this->SfuArrivalTime);
     doParsimUnpacking(b,this->SfuDepartureTime);
+    doParsimUnpacking(b,this->MfuArrivalTime);
     doParsimUnpacking(b,this->OnuArrivalTime);
     doParsimUnpacking(b,this->OnuDepartureTime);
     doParsimUnpacking(b,this->OnuId);
@@ -221,6 +232,10 @@ void ethPacket::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->MfuId);
     doParsimUnpacking(b,this->TContId);
     doParsimUnpacking(b,this->FragmentCount);
+    doParsimUnpacking(b,this->DeviceId);
+    doParsimUnpacking(b,this->SourceId);
+    doParsimUnpacking(b,this->SeqNo);
+    doParsimUnpacking(b,this->MoreFragments);
 }
 
 omnetpp::simtime_t ethPacket::getGenerationTime() const
@@ -273,6 +288,16 @@ void ethPacket::setSfuDepartureTime(omnetpp::simtime_t SfuDepartureTime)
     this->SfuDepartureTime = SfuDepartureTime;
 }
 
+omnetpp::simtime_t ethPacket::getMfuArrivalTime() const
+{
+    return this->MfuArrivalTime;
+}
+
+void ethPacket::setMfuArrivalTime(omnetpp::simtime_t MfuArrivalTime)
+{
+    this->MfuArrivalTime = MfuArrivalTime;
+}
+
 omnetpp::simtime_t ethPacket::getOnuArrivalTime() const
 {
     return this->OnuArrivalTime;
@@ -343,6 +368,46 @@ void ethPacket::setFragmentCount(int FragmentCount)
     this->FragmentCount = FragmentCount;
 }
 
+int ethPacket::getDeviceId() const
+{
+    return this->DeviceId;
+}
+
+void ethPacket::setDeviceId(int DeviceId)
+{
+    this->DeviceId = DeviceId;
+}
+
+int ethPacket::getSourceId() const
+{
+    return this->SourceId;
+}
+
+void ethPacket::setSourceId(int SourceId)
+{
+    this->SourceId = SourceId;
+}
+
+long ethPacket::getSeqNo() const
+{
+    return this->SeqNo;
+}
+
+void ethPacket::setSeqNo(long SeqNo)
+{
+    this->SeqNo = SeqNo;
+}
+
+bool ethPacket::getMoreFragments() const
+{
+    return this->MoreFragments;
+}
+
+void ethPacket::setMoreFragments(bool MoreFragments)
+{
+    this->MoreFragments = MoreFragments;
+}
+
 class ethPacketDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -353,6 +418,7 @@ class ethPacketDescriptor : public omnetpp::cClassDescriptor
         FIELD_WapDepartureTime,
         FIELD_SfuArrivalTime,
         FIELD_SfuDepartureTime,
+        FIELD_MfuArrivalTime,
         FIELD_OnuArrivalTime,
         FIELD_OnuDepartureTime,
         FIELD_OnuId,
@@ -360,6 +426,10 @@ class ethPacketDescriptor : public omnetpp::cClassDescriptor
         FIELD_MfuId,
         FIELD_TContId,
         FIELD_FragmentCount,
+        FIELD_DeviceId,
+        FIELD_SourceId,
+        FIELD_SeqNo,
+        FIELD_MoreFragments,
     };
   public:
     ethPacketDescriptor();
@@ -426,7 +496,7 @@ const char *ethPacketDescriptor::getProperty(const char *propertyName) const
 int ethPacketDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *base = getBaseClassDescriptor();
-    return base ? 12+base->getFieldCount() : 12;
+    return base ? 17+base->getFieldCount() : 17;
 }
 
 unsigned int ethPacketDescriptor::getFieldTypeFlags(int field) const
@@ -443,6 +513,7 @@ unsigned int ethPacketDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,    // FIELD_WapDepartureTime
         FD_ISEDITABLE,    // FIELD_SfuArrivalTime
         FD_ISEDITABLE,    // FIELD_SfuDepartureTime
+        FD_ISEDITABLE,    // FIELD_MfuArrivalTime
         FD_ISEDITABLE,    // FIELD_OnuArrivalTime
         FD_ISEDITABLE,    // FIELD_OnuDepartureTime
         FD_ISEDITABLE,    // FIELD_OnuId
@@ -450,8 +521,12 @@ unsigned int ethPacketDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,    // FIELD_MfuId
         FD_ISEDITABLE,    // FIELD_TContId
         FD_ISEDITABLE,    // FIELD_FragmentCount
+        FD_ISEDITABLE,    // FIELD_DeviceId
+        FD_ISEDITABLE,    // FIELD_SourceId
+        FD_ISEDITABLE,    // FIELD_SeqNo
+        FD_ISEDITABLE,    // FIELD_MoreFragments
     };
-    return (field >= 0 && field < 12) ? fieldTypeFlags[field] : 0;
+    return (field >= 0 && field < 17) ? fieldTypeFlags[field] : 0;
 }
 
 const char *ethPacketDescriptor::getFieldName(int field) const
@@ -468,6 +543,7 @@ const char *ethPacketDescriptor::getFieldName(int field) const
         "WapDepartureTime",
         "SfuArrivalTime",
         "SfuDepartureTime",
+        "MfuArrivalTime",
         "OnuArrivalTime",
         "OnuDepartureTime",
         "OnuId",
@@ -475,8 +551,12 @@ const char *ethPacketDescriptor::getFieldName(int field) const
         "MfuId",
         "TContId",
         "FragmentCount",
+        "DeviceId",
+        "SourceId",
+        "SeqNo",
+        "MoreFragments",
     };
-    return (field >= 0 && field < 12) ? fieldNames[field] : nullptr;
+    return (field >= 0 && field < 17) ? fieldNames[field] : nullptr;
 }
 
 int ethPacketDescriptor::findField(const char *fieldName) const
@@ -488,13 +568,18 @@ int ethPacketDescriptor::findField(const char *fieldName) const
     if (strcmp(fieldName, "WapDepartureTime") == 0) return baseIndex + 2;
     if (strcmp(fieldName, "SfuArrivalTime") == 0) return baseIndex + 3;
     if (strcmp(fieldName, "SfuDepartureTime") == 0) return baseIndex + 4;
-    if (strcmp(fieldName, "OnuArrivalTime") == 0) return baseIndex + 5;
-    if (strcmp(fieldName, "OnuDepartureTime") == 0) return baseIndex + 6;
-    if (strcmp(fieldName, "OnuId") == 0) return baseIndex + 7;
-    if (strcmp(fieldName, "SfuId") == 0) return baseIndex + 8;
-    if (strcmp(fieldName, "MfuId") == 0) return baseIndex + 9;
-    if (strcmp(fieldName, "TContId") == 0) return baseIndex + 10;
-    if (strcmp(fieldName, "FragmentCount") == 0) return baseIndex + 11;
+    if (strcmp(fieldName, "MfuArrivalTime") == 0) return baseIndex + 5;
+    if (strcmp(fieldName, "OnuArrivalTime") == 0) return baseIndex + 6;
+    if (strcmp(fieldName, "OnuDepartureTime") == 0) return baseIndex + 7;
+    if (strcmp(fieldName, "OnuId") == 0) return baseIndex + 8;
+    if (strcmp(fieldName, "SfuId") == 0) return baseIndex + 9;
+    if (strcmp(fieldName, "MfuId") == 0) return baseIndex + 10;
+    if (strcmp(fieldName, "TContId") == 0) return baseIndex + 11;
+    if (strcmp(fieldName, "FragmentCount") == 0) return baseIndex + 12;
+    if (strcmp(fieldName, "DeviceId") == 0) return baseIndex + 13;
+    if (strcmp(fieldName, "SourceId") == 0) return baseIndex + 14;
+    if (strcmp(fieldName, "SeqNo") == 0) return baseIndex + 15;
+    if (strcmp(fieldName, "MoreFragments") == 0) return baseIndex + 16;
     return base ? base->findField(fieldName) : -1;
 }
 
@@ -512,6 +597,7 @@ const char *ethPacketDescriptor::getFieldTypeString(int field) const
         "omnetpp::simtime_t",    // FIELD_WapDepartureTime
         "omnetpp::simtime_t",    // FIELD_SfuArrivalTime
         "omnetpp::simtime_t",    // FIELD_SfuDepartureTime
+        "omnetpp::simtime_t",    // FIELD_MfuArrivalTime
         "omnetpp::simtime_t",    // FIELD_OnuArrivalTime
         "omnetpp::simtime_t",    // FIELD_OnuDepartureTime
         "int",    // FIELD_OnuId
@@ -519,8 +605,12 @@ const char *ethPacketDescriptor::getFieldTypeString(int field) const
         "int",    // FIELD_MfuId
         "int",    // FIELD_TContId
         "int",    // FIELD_FragmentCount
+        "int",    // FIELD_DeviceId
+        "int",    // FIELD_SourceId
+        "long",    // FIELD_SeqNo
+        "bool",    // FIELD_MoreFragments
     };
-    return (field >= 0 && field < 12) ? fieldTypeStrings[field] : nullptr;
+    return (field >= 0 && field < 17) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **ethPacketDescriptor::getFieldPropertyNames(int field) const
@@ -608,6 +698,7 @@ std::string ethPacketDescriptor::getFieldValueAsString(omnetpp::any_ptr object,
         case FIELD_WapDepartureTime: return simtime2string(pp->getWapDepartureTime());
         case FIELD_SfuArrivalTime: return simtime2string(pp->getSfuArrivalTime());
         case FIELD_SfuDepartureTime: return simtime2string(pp->getSfuDepartureTime());
+        case FIELD_MfuArrivalTime: return simtime2string(pp->getMfuArrivalTime());
         case FIELD_OnuArrivalTime: return simtime2string(pp->getOnuArrivalTime());
         case FIELD_OnuDepartureTime: return simtime2string(pp->getOnuDepartureTime());
         case FIELD_OnuId: return long2string(pp->getOnuId());
@@ -615,6 +706,10 @@ std::string ethPacketDescriptor::getFieldValueAsString(omnetpp::any_ptr object,
         case FIELD_MfuId: return long2string(pp->getMfuId());
         case FIELD_TContId: return long2string(pp->getTContId());
         case FIELD_FragmentCount: return long2string(pp->getFragmentCount());
+        case FIELD_DeviceId: return long2string(pp->getDeviceId());
+        case FIELD_SourceId: return long2string(pp->getSourceId());
+        case FIELD_SeqNo: return long2string(pp->getSeqNo());
+        case FIELD_MoreFragments: return bool2string(pp->getMoreFragments());
         default: return "";
     }
 }
@@ -636,6 +731,7 @@ void ethPacketDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int fie
         case FIELD_WapDepartureTime: pp->setWapDepartureTime(string2simtime(value)); break;
         case FIELD_SfuArrivalTime: pp->setSfuArrivalTime(string2simtime(value)); break;
         case FIELD_SfuDepartureTime: pp->setSfuDepartureTime(string2simtime(value)); break;
+        case FIELD_MfuArrivalTime: pp->setMfuArrivalTime(string2simtime(value)); break;
         case FIELD_OnuArrivalTime: pp->setOnuArrivalTime(string2simtime(value)); break;
         case FIELD_OnuDepartureTime: pp->setOnuDepartureTime(string2simtime(value)); break;
         case FIELD_OnuId: pp->setOnuId(string2long(value)); break;
@@ -643,6 +739,10 @@ void ethPacketDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int fie
         case FIELD_MfuId: pp->setMfuId(string2long(value)); break;
         case FIELD_TContId: pp->setTContId(string2long(value)); break;
         case FIELD_FragmentCount: pp->setFragmentCount(string2long(value)); break;
+        case FIELD_DeviceId: pp->setDeviceId(string2long(value)); break;
+        case FIELD_SourceId: pp->setSourceId(string2long(value)); break;
+        case FIELD_SeqNo: pp->setSeqNo(string2long(value)); break;
+        case FIELD_MoreFragments: pp->setMoreFragments(string2bool(value)); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'ethPacket'", field);
     }
 }
@@ -662,6 +762,7 @@ omnetpp::cValue ethPacketDescriptor::getFieldValue(omnetpp::any_ptr object, int
         case FIELD_WapDepartureTime: return pp->getWapDepartureTime().dbl();
         case FIELD_SfuArrivalTime: return pp->getSfuArrivalTime().dbl();
         case FIELD_SfuDepartureTime: return pp->getSfuDepartureTime().dbl();
+        case FIELD_MfuArrivalTime: return pp->getMfuArrivalTime().dbl();
         case FIELD_OnuArrivalTime: return pp->getOnuArrivalTime().dbl();
         case FIELD_OnuDepartureTime: return pp->getOnuDepartureTime().dbl();
         case FIELD_OnuId: return pp->getOnuId();
@@ -669,6 +770,10 @@ omnetpp::cValue ethPacketDescriptor::getFieldValue(omnetpp::any_ptr object, int
         case FIELD_MfuId: return pp->getMfuId();
         case FIELD_TContId: return pp->getTContId();
         case FIELD_FragmentCount: return pp->getFragmentCount();
+        case FIELD_DeviceId: return pp->getDeviceId();
+        case FIELD_SourceId: return pp->getSourceId();
+        case FIELD_SeqNo: return (omnetpp::intval_t)(pp->getSeqNo());
+        case FIELD_MoreFragments: return pp->getMoreFragments();
         default: throw omnetpp::cRuntimeError("Cannot return field %d of class 'ethPacket' as cValue -- field index out of range?", field);
     }
 }
@@ -690,6 +795,7 @@ void ethPacketDescriptor::setFieldValue(omnetpp::any_ptr object, int field, int
         case FIELD_WapDepartureTime: pp->setWapDepartureTime(value.doubleValue()); break;
         case FIELD_SfuArrivalTime: pp->setSfuArrivalTime(value.doubleValue()); break;
         case FIELD_SfuDepartureTime: pp->setSfuDepartureTime(value.doubleValue()); break;
+        case FIELD_MfuArrivalTime: pp->setMfuArrivalTime(value.doubleValue()); break;
         case FIELD_OnuArrivalTime: pp->setOnuArrivalTime(value.doubleValue()); break;
         case FIELD_OnuDepartureTime: pp->setOnuDepartureTime(value.doubleValue()); break;
         case FIELD_OnuId: pp->setOnuId(omnetpp::checked_int_cast<int>(value.intValue())); break;
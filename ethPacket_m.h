@@ -27,6 +27,7 @@ class ethPacket;
  *     simtime_t WapDepartureTime;
  *     simtime_t SfuArrivalTime;
  *     simtime_t SfuDepartureTime;
+ *     simtime_t MfuArrivalTime;
  *     simtime_t OnuArrivalTime;
  *     simtime_t OnuDepartureTime;
  *     //simtime_t OltArrivalTime;
@@ -36,6 +37,10 @@ class ethPacket;
  *     int MfuId;
  *     int TContId;						// T-CONT type
  *     int FragmentCount = 0;				// id of fragmented packet
+ *     int DeviceId = 0;					// device slot behind the WAP (background device 1..3) for downstream delivery
+ *     int SourceId = -1;					// module id of the generating device, flow id of the columnar results
+ *     long SeqNo = 0;						// per-source packet number, (SourceId, SeqNo) identifies the fragments of one packet
+ *     bool MoreFragments = false;			// set on every fragment except the last one of a packet
  * }
  * </pre>
  */
@@ -47,6 +52,7 @@ class ethPacket : public ::omnetpp::cPacket
     omnetpp::simtime_t WapDepartureTime = SIMTIME_ZERO;
     omnetpp::simtime_t SfuArrivalTime = SIMTIME_ZERO;
     omnetpp::simtime_t SfuDepartureTime = SIMTIME_ZERO;
+    omnetpp::simtime_t MfuArrivalTime = SIMTIME_ZERO;
     omnetpp::simtime_t OnuArrivalTime = SIMTIME_ZERO;
     omnetpp::simtime_t OnuDepartureTime = SIMTIME_ZERO;
     int OnuId = 0;
@@ -54,6 +60,10 @@ class ethPacket : public ::omnetpp::cPacket
     int MfuId = 0;
     int TContId = 0;
     int FragmentCount = 0;
+    int DeviceId = 0;
+    int SourceId = -1;
+    long SeqNo = 0;
+    bool MoreFragments = false;
 
   private:
     void copy(const ethPacket& other);
@@ -85,6 +95,9 @@ class ethPacket : public ::omnetpp::cPacket
     virtual omnetpp::simtime_t getSfuDepartureTime() const;
     virtual void setSfuDepartureTime(omnetpp::simtime_t SfuDepartureTime);
 
+    virtual omnetpp::simtime_t getMfuArrivalTime() const;
+    virtual void setMfuArrivalTime(omnetpp::simtime_t MfuArrivalTime);
+
     virtual omnetpp::simtime_t getOnuArrivalTime() const;
     virtual void setOnuArrivalTime(omnetpp::simtime_t OnuArrivalTime);
 
@@ -105,6 +118,18 @@ class ethPacket : public ::omnetpp::cPacket
 
     virtual int getFragmentCount() const;
     virtual void setFragmentCount(int FragmentCount);
+
+    virtual int getDeviceId() const;
+    virtual void setDeviceId(int DeviceId);
+
+    virtual int getSourceId() const;
+    virtual void setSourceId(int SourceId);
+
+    virtual long getSeqNo() const;
+    virtual void setSeqNo(long SeqNo);
+
+    virtual bool getMoreFragments() const;
+    virtual void setMoreFragments(bool MoreFragments);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const ethPacket& obj) {obj.parsimPack(b);}
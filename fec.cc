@@ -0,0 +1,103 @@
+/*
+ * fec.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <math.h>
+#include <omnetpp.h>
+
+#include "fec.h"
+
+using namespace omnetpp;
+
+// P(X > t) for X ~ Binomial(n, p), summed in log space from t+1 until the terms vanish
+static double binomial_tail(int n, double p, int t)
+{
+    if(p <= 0)
+        return 0;
+    if(p >= 1)
+        return 1;
+    double sum = 0;
+    for(int j = t + 1; j <= n; j++) {
+        double term = exp(lgamma(n + 1.0) - lgamma(j + 1.0) - lgamma(n - j + 1.0) + j*log(p) + (n - j)*log1p(-p));
+        sum += term;
+        if((j > n*p)&&(term < sum*1e-16))
+            break;
+    }
+    return std::min(1.0, sum);
+}
+
+double Fec::codeRate(const std::string &code)
+{
+    if(code == "ldpc")
+        return 14592.0/17280;
+    if(code == "rs")
+        return 216.0/248;
+    if(code == "none")
+        return 1;
+    throw cRuntimeError("unknown FEC code '%s' (ldpc, rs, none)", code.c_str());
+}
+
+void Fec::init(const std::string &code, double ber, cRNG *rng)
+{
+    this->rng = rng;
+    if(code == "ldpc") {
+        infoBits = 14592;
+        pLost = binomial_tail(17280, ber, 270);
+    }
+    else if(code == "rs") {
+        infoBits = 216*8;
+        pLost = binomial_tail(248, 1 - pow(1 - ber, 8), 16);      // symbol errors, t = (248-216)/2
+    }
+    else if(code == "none") {
+        infoBits = 1;
+        pLost = std::min(1.0, std::max(0.0, ber));
+    }
+    else {
+        throw cRuntimeError("unknown FEC code '%s' (ldpc, rs, none)", code.c_str());
+    }
+    pos = 0;
+    lastLost = -1;
+    codewords = lostCodewords = 0;
+    drawNext(-1);
+}
+
+void Fec::drawNext(double after)
+{
+    if(pLost <= 0) {
+        nextLost = INFINITY;
+    }
+    else if(pLost >= 1) {
+        nextLost = after + 1;
+    }
+    else {
+        nextLost = after + 1 + floor(log(rng->doubleRandNonz())/log1p(-pLost));    // good codewords before the next lost one
+    }
+}
+
+void Fec::startBurst()
+{
+    double cw = ceil(pos/infoBits);                 // the last codeword of the previous burst is padded
+    codewords = (long)cw;
+    pos = cw*infoBits;
+}
+
+bool Fec::corrupts(double bits)
+{
+    if(bits <= 0)
+        return false;
+    double first = floor(pos/infoBits);
+    double last = floor((pos + bits - 1)/infoBits);   // codewords covered by these bits
+    pos += bits;
+    codewords = (long)ceil(pos/infoBits);
+    bool hit = (lastLost >= first);                 // lost codeword shared with the previous packet
+    while(nextLost <= last) {
+        lostCodewords++;
+        lastLost = nextLost;
+        drawNext(nextLost);
+        hit = true;
+    }
+    return hit;
+}
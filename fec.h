@@ -0,0 +1,49 @@
+/*
+ * fec.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef FEC_H_
+#define FEC_H_
+
+#include <string>
+
+namespace omnetpp { class cRNG; }
+
+/*
+ * Codeword errors of the upstream bursts received by the OLT (50G-PON, LDPC(17280,14592)) and
+ * the MFUs (10G-PON, RS(248,216)). The decoder is approximated as bounded-distance: a codeword
+ * is lost when more than t bits (LDPC) or 8-bit symbols (RS) of it are in error, t = 270 puts the
+ * LDPC output at 1e-12 for the 1e-2 input BER it is specified for. Without FEC every bit is a
+ * codeword of its own. The payload of a burst fills consecutive codewords from the start of the
+ * burst; instead of testing every bit or codeword, the number of good codewords up to the next
+ * lost one is drawn from the geometric distribution, so a packet costs O(1) whatever the BER.
+ * The airtime overhead of the parity bits is applied separately through the payload rate of the
+ * link (PonParams::extPonPayloadRate/intPonPayloadRate, the line rate times codeRate()).
+ */
+class Fec
+{
+    private:
+        double infoBits = 1;                    // payload bits per codeword
+        double pLost = 0;                       // probability that a codeword is uncorrectable
+        double pos = 0;                         // payload bits received since the start of the run
+        double nextLost = 0;                    // index of the next uncorrectable codeword
+        double lastLost = -1;
+        omnetpp::cRNG *rng = nullptr;
+
+        void drawNext(double after);
+
+    public:
+        long codewords = 0;                     // codewords received
+        long lostCodewords = 0;
+
+        void init(const std::string &code, double ber, omnetpp::cRNG *rng);
+        void startBurst();                      // a new burst starts with a new codeword
+        bool corrupts(double bits);             // receives the next bits of the burst, true if a lost codeword covers any of them
+        double getCodewordLoss() const { return pLost; }
+        static double codeRate(const std::string &code);
+};
+
+#endif /* FEC_H_ */
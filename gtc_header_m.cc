@@ -284,6 +284,7 @@ void gtc_header::copy(const gtc_header& other)
     this->BufferOccupancyTC2 = other.BufferOccupancyTC2;
     this->BufferOccupancyTC3 = other.BufferOccupancyTC3;
     this->SeqID = other.SeqID;
+    this->Teqd = other.Teqd;
 }
 
 void gtc_header::parsimPack(omnetpp::cCommBuffer *b) const
@@ -328,6 +329,7 @@ void gtc_header::parsimPack(omnetpp::cCommBuffer *b) const
     doParsimPacking(b,this->BufferOccupancyTC2);
     doParsimPacking(b,this->BufferOccupancyTC3);
     doParsimPacking(b,this->SeqID);
+    doParsimPacking(b,this->Teqd);
 }
 
 void gtc_header::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -456,6 +458,7 @@ void gtc_header::parsimUnpack(omnetpp::cCommBuffer *b)
     doParsimUnpacking(b,this->BufferOccupancyTC2);
     doParsimUnpacking(b,this->BufferOccupancyTC3);
     doParsimUnpacking(b,this->SeqID);
+    doParsimUnpacking(b,this->Teqd);
 }
 
 bool gtc_header::getDownlink() const
@@ -1492,6 +1495,16 @@ void gtc_header::setSeqID(long SeqID)
     this->SeqID = SeqID;
 }
 
+double gtc_header::getTeqd() const
+{
+    return this->Teqd;
+}
+
+void gtc_header::setTeqd(double Teqd)
+{
+    this->Teqd = Teqd;
+}
+
 class gtc_headerDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -1522,6 +1535,7 @@ class gtc_headerDescriptor : public omnetpp::cClassDescriptor
         FIELD_BufferOccupancyTC2,
         FIELD_BufferOccupancyTC3,
         FIELD_SeqID,
+        FIELD_Teqd,
     };
   public:
     gtc_headerDescriptor();
@@ -1588,7 +1602,7 @@ const char *gtc_headerDescriptor::getProperty(const char *propertyName) const
 int gtc_headerDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *base = getBaseClassDescriptor();
-    return base ? 25+base->getFieldCount() : 25;
+    return base ? 26+base->getFieldCount() : 26;
 }
 
 unsigned int gtc_headerDescriptor::getFieldTypeFlags(int field) const
@@ -1625,8 +1639,9 @@ unsigned int gtc_headerDescriptor::getFieldTypeFlags(int field) const
         FD_ISEDITABLE,    // FIELD_BufferOccupancyTC2
         FD_ISEDITABLE,    // FIELD_BufferOccupancyTC3
         FD_ISEDITABLE,    // FIELD_SeqID
+        FD_ISEDITABLE,    // FIELD_Teqd
     };
-    return (field >= 0 && field < 25) ? fieldTypeFlags[field] : 0;
+    return (field >= 0 && field < 26) ? fieldTypeFlags[field] : 0;
 }
 
 const char *gtc_headerDescriptor::getFieldName(int field) const
@@ -1663,8 +1678,9 @@ const char *gtc_headerDescriptor::getFieldName(int field) const
         "BufferOccupancyTC2",
         "BufferOccupancyTC3",
         "SeqID",
+        "Teqd",
     };
-    return (field >= 0 && field < 25) ? fieldNames[field] : nullptr;
+    return (field >= 0 && field < 26) ? fieldNames[field] : nullptr;
 }
 
 int gtc_headerDescriptor::findField(const char *fieldName) const
@@ -1696,6 +1712,7 @@ int gtc_headerDescriptor::findField(const char *fieldName) const
     if (strcmp(fieldName, "BufferOccupancyTC2") == 0) return baseIndex + 22;
     if (strcmp(fieldName, "BufferOccupancyTC3") == 0) return baseIndex + 23;
     if (strcmp(fieldName, "SeqID") == 0) return baseIndex + 24;
+    if (strcmp(fieldName, "Teqd") == 0) return baseIndex + 25;
     return base ? base->findField(fieldName) : -1;
 }
 
@@ -1733,8 +1750,9 @@ const char *gtc_headerDescriptor::getFieldTypeString(int field) const
         "double",    // FIELD_BufferOccupancyTC2
         "double",    // FIELD_BufferOccupancyTC3
         "long",    // FIELD_SeqID
+        "double",    // FIELD_Teqd
     };
-    return (field >= 0 && field < 25) ? fieldTypeStrings[field] : nullptr;
+    return (field >= 0 && field < 26) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **gtc_headerDescriptor::getFieldPropertyNames(int field) const
@@ -1870,6 +1888,7 @@ std::string gtc_headerDescriptor::getFieldValueAsString(omnetpp::any_ptr object,
         case FIELD_BufferOccupancyTC2: return double2string(pp->getBufferOccupancyTC2());
         case FIELD_BufferOccupancyTC3: return double2string(pp->getBufferOccupancyTC3());
         case FIELD_SeqID: return long2string(pp->getSeqID());
+        case FIELD_Teqd: return double2string(pp->getTeqd());
         default: return "";
     }
 }
@@ -1911,6 +1930,7 @@ void gtc_headerDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int fi
         case FIELD_BufferOccupancyTC2: pp->setBufferOccupancyTC2(string2double(value)); break;
         case FIELD_BufferOccupancyTC3: pp->setBufferOccupancyTC3(string2double(value)); break;
         case FIELD_SeqID: pp->setSeqID(string2long(value)); break;
+        case FIELD_Teqd: pp->setTeqd(string2double(value)); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'gtc_header'", field);
     }
 }
@@ -1950,6 +1970,7 @@ omnetpp::cValue gtc_headerDescriptor::getFieldValue(omnetpp::any_ptr object, int
         case FIELD_BufferOccupancyTC2: return pp->getBufferOccupancyTC2();
         case FIELD_BufferOccupancyTC3: return pp->getBufferOccupancyTC3();
         case FIELD_SeqID: return (omnetpp::intval_t)(pp->getSeqID());
+        case FIELD_Teqd: return pp->getTeqd();
         default: throw omnetpp::cRuntimeError("Cannot return field %d of class 'gtc_header' as cValue -- field index out of range?", field);
     }
 }
@@ -66,6 +66,7 @@ class gtc_header;
  *     double BufferOccupancyTC3 = 0;				// 24 bits
  * 
  *     long SeqID;
+ *     double Teqd = 0;					// equalisation delay: every ONU/SFU answers a grant Teqd - RTT after receiving it
  * 
  *     // int flags;						// 8 bits
  *     // int allocID;						// 12 bits
@@ -115,6 +116,7 @@ class gtc_header : public ::omnetpp::cPacket
     double BufferOccupancyTC2 = 0;
     double BufferOccupancyTC3 = 0;
     long SeqID = 0;
+    double Teqd = 0;
 
   private:
     void copy(const gtc_header& other);
@@ -289,6 +291,9 @@ class gtc_header : public ::omnetpp::cPacket
 
     virtual long getSeqID() const;
     virtual void setSeqID(long SeqID);
+
+    virtual double getTeqd() const;
+    virtual void setTeqd(double Teqd);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const gtc_header& obj) {obj.parsimPack(b);}
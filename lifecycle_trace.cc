@@ -0,0 +1,81 @@
+/*
+ * lifecycle_trace.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <omnetpp.h>
+
+#include "lifecycle_trace.h"
+
+using namespace omnetpp;
+
+static const size_t header_size = 64;
+
+void LifecycleTrace::open(const std::string &path, uint64_t capacity, bool ring)
+{
+    close();
+    this->capacity = capacity > 0 ? capacity : 1;
+    this->ring = ring;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        throw cRuntimeError("cannot create lifecycle trace '%s'", path.c_str());
+    mapFile();
+
+    memcpy(map, "FTTRLCY1", 8);
+    uint32_t rec_size = sizeof(LifecycleRecord), is_ring = ring;
+    memcpy(map + 8, &rec_size, 4);
+    memcpy(map + 12, &is_ring, 4);
+    memcpy(map + 16, &this->capacity, 8);
+    memset(map + 24, 0, 8);                     // records written
+}
+
+void LifecycleTrace::mapFile()
+{
+    mapLength = header_size + capacity*sizeof(LifecycleRecord);
+    if(ftruncate(fd, mapLength) != 0)
+        throw cRuntimeError("cannot resize lifecycle trace to %lu bytes", (unsigned long)mapLength);
+    void *m = mmap(nullptr, mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(m == MAP_FAILED)
+        throw cRuntimeError("cannot map lifecycle trace");
+    map = (char *)m;
+}
+
+uint64_t LifecycleTrace::getWritten() const
+{
+    uint64_t n;
+    memcpy(&n, map + 24, 8);
+    return n;
+}
+
+void LifecycleTrace::write(const LifecycleRecord &rec)
+{
+    uint64_t n = getWritten();
+    if(!ring && n >= capacity) {                // append mode: double the file and map it again
+        munmap(map, mapLength);
+        capacity *= 2;
+        mapFile();
+        memcpy(map + 16, &capacity, 8);
+    }
+    memcpy(map + header_size + (n % capacity)*sizeof(LifecycleRecord), &rec, sizeof(rec));
+    n++;
+    memcpy(map + 24, &n, 8);                    // count updated once the record is complete
+}
+
+void LifecycleTrace::close()
+{
+    if(map != nullptr) {
+        msync(map, mapLength, MS_ASYNC);
+        munmap(map, mapLength);
+        map = nullptr;
+    }
+    if(fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * lifecycle_trace.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef LIFECYCLE_TRACE_H_
+#define LIFECYCLE_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/*
+ * Per-packet lifecycle records in a memory-mapped file, queried offline with tools/lifecycle_query.py.
+ * A record is copied into the mapping as it is, without any formatting. In ring mode the file
+ * holds the last `capacity` packets; in append mode it grows by doubling and keeps all of them.
+ *
+ * file:   64-byte header ("FTTRLCY1", uint32 record size, uint32 ring, uint64 capacity,
+ *         uint64 records written) | capacity x LifecycleRecord
+ * In ring mode record n is stored in slot n % capacity.
+ */
+struct LifecycleRecord
+{
+    double generation;                          // the eight timestamps of the packet (s)
+    double wapArrival;
+    double wapDeparture;
+    double sfuArrival;
+    double sfuDeparture;
+    double onuArrival;
+    double onuDeparture;
+    double oltArrival;
+    int32_t sourceId;                           // generating device, flow id
+    int32_t onuId;
+    int32_t sfuId;
+    int32_t mfuId;
+    int32_t bytes;
+    uint8_t cls;                                // traffic class, order of the OLT ci_class_names
+    uint8_t tcont;
+    uint16_t fragmentCount;
+};
+
+class LifecycleTrace
+{
+    private:
+        int fd = -1;
+        char *map = nullptr;
+        size_t mapLength = 0;
+        uint64_t capacity = 0;
+        bool ring = true;
+
+        void mapFile();
+
+    public:
+        ~LifecycleTrace() { close(); }
+        void open(const std::string &path, uint64_t capacity, bool ring);
+        bool isOpen() const { return map != nullptr; }
+        void write(const LifecycleRecord &rec);
+        uint64_t getWritten() const;
+        void close();
+};
+
+#endif /* LIFECYCLE_TRACE_H_ */
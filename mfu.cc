@@ -12,9 +12,14 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "reassembly.h"
+#include "fec.h"
 
 using namespace std;
 using namespace omnetpp;
@@ -22,6 +27,8 @@ using namespace omnetpp;
 class MFU : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        PonParams pon;                          // PON dimensioning of this run
         vector<double> sfu_rtt;
         vector<double> sfu_buffer_TC1;
         vector<double> sfu_buffer_TC2;
@@ -41,35 +48,82 @@ class MFU : public cSimpleModule
         int sfus;
         int ping_count = 0;
         double sfu_max_grant;
+        double t_guard;                         // guard time between bursts, shrunk for very large splits
+        double response_time;                   // SFU processing time between a grant and its burst
+        double teqd_fixed;                      // configured Teqd, -1 = derived from the worst RTT
+        double teqd = 0;                        // equalisation delay of the current cycle, every burst arrives Teqd + start time after its grant
+        double ranging_interval;
+        long rangings = 0;
+
+        cQueue dl_queue;                        // downstream payload waiting for the next 10G-PON frames
+        double dl_queue_size = 0;
+        double dl_frame_budget = 0;             // bytes left in the current downstream frame
+        cMessage *send_dl_payload = nullptr;    // drains dl_queue within the current downstream frame
+        Telemetry *telemetry = nullptr;         // live DBA state for tools/telemetry_view.py, nullptr = off
+        bool reassemble;
+        Reassembly reassembly;                  // SFU fragments, only whole packets are forwarded to the ONU
 
         //simsignal_t errorSignal;
 
     public:
-        //virtual ~MFU();
+        virtual ~MFU();
 
     protected:
         double ber;
         long totalBitsReceived = 0;
+        long goodBitsReceived = 0;              // received bits outside lost codewords
         long totalPacketsReceived = 0;
         long corruptedPackets = 0;
+        Fec fec;                                // lost codewords of the upstream bursts
 
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
+        virtual void takeSnapshot();
+        virtual bool restoreSnapshot();
+        virtual void publishTelemetry();
         //virtual ponPacket *generateGrantPacket();
 };
 
 Define_Module(MFU);
 
+MFU::~MFU()
+{
+    cancelAndDelete(send_dl_payload);
+    while (!dl_queue.isEmpty()) {
+        delete dl_queue.pop();
+    }
+    Telemetry::detach(telemetry);
+}
+
 void MFU::initialize()
 {
+    pon.read(getParentModule());
+    check_and_cast<cDatarateChannel *>(gate("SpltGate_i")->getPreviousGate()->getChannel())->setDatarate(pon.intPonPayloadRate);   // splitter-MFU fibre, FEC parity excluded
+    ber = par("ber");
+    fec.init(pon.intPonFec, ber, getRNG(rng_fec));
     //errorSignal = registerSignal("pkt_error");  // registering the signal
 
     gate("SpltGate_i")->setDeliverImmediately(true);
+    gate("OnuGate_in")->setDeliverImmediately(true);
+
+    dl_queue.setName("dl_queue");
+    send_dl_payload = new cMessage("send_dl_payload");
 
     sfus = par("NumberOfSFUs");
+    t_guard = std::min(pon.guardTime, pon.maxPollingCycle/(2*sfus));      // guards never take more than half of the cycle
     EV << "[mfu" << getIndex() << "] No. of sfus detected = " << sfus << endl;
 
+    reassemble = par("reassembly");
+    reassembly.init(par("reassemblyTimeout").doubleValue(), par("reassemblyMaxPending").intValue());
+
+    string telemetry_name = getParentModule()->par("telemetry").stdstringValue();
+    if(!telemetry_name.empty()) {
+        telemetry = Telemetry::attach(telemetry_name, getParentModule()->par("NumberOfONUs"), sfus,
+                                      getParentModule()->par("telemetryInterval"));
+    }
+
     sfu_rtt.resize(sfus,0.0);
     sfu_buffer_TC1.resize(sfus,0.0);
     sfu_buffer_TC2.resize(sfus,0.0);
@@ -88,14 +142,56 @@ void MFU::initialize()
     //EV << "[mfu" << getIndex() << "] onu_rtt[0] = " << onu_rtt[0] << ", onu_rtt[1] = " << onu_rtt[1] << endl;
     // bw_map = [onu_id, tc_type, start_time, grant_size]
 
+    double snapshot_at = par("snapshotAt");
+    if(snapshot_at >= 0) {
+        scheduleAt(snapshot_at, new cMessage("take_snapshot"));
+    }
+    response_time = par("responseTime").doubleValueInUnit("s");
+    teqd_fixed = par("equalisationDelay").doubleValueInUnit("s");
+    ranging_interval = par("rangingInterval").doubleValueInUnit("s");
+    if(ranging_interval > 0) {
+        scheduleAt(simTime()+ranging_interval, new cMessage("start_ranging"));
+    }
+    if(par("restoreSnapshot").boolValue() && restoreSnapshot()) {
+        return;                         // ranging is skipped, the RTT table comes from the snapshot
+    }
+
     ping *png = new ping("ping");      // sending ping message at T = 0 for finding the RTT of all SFUs
+    png->setSendTime(simTime());
     send(png,"SpltGate_o");
+    rangings++;
     EV << "[mfu" << getIndex() << "] Sending ping from MFU at = " << simTime() << endl;
 }
 
 void MFU::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(dl_queue.getLength());
     if(msg->isPacket() == true) {
+        if(msg->arrivedOn("SpltGate_i")) {
+            if(strcmp(msg->getName(),"gtc_hdr_ul") == 0) {
+                fec.startBurst();       // every SFU burst starts with its report in a new codeword
+            }
+            totalPacketsReceived++;
+            totalBitsReceived += check_and_cast<cPacket *>(msg)->getBitLength();
+            if(fec.corrupts(check_and_cast<cPacket *>(msg)->getBitLength())) {
+                corruptedPackets++;     // a lost codeword covers part of it, the packet is lost
+                if(reassemble && (dynamic_cast<ethPacket *>(msg) != nullptr))
+                    reassembly.discard(check_and_cast<ethPacket *>(msg));
+                delete msg;
+                return;
+            }
+            goodBitsReceived += check_and_cast<cPacket *>(msg)->getBitLength();
+        }
+
+        if(reassemble && msg->arrivedOn("SpltGate_i") && (dynamic_cast<ethPacket *>(msg) != nullptr)) {
+            if(!reassembly.add(check_and_cast<ethPacket *>(msg))) {
+                delete msg;             // leading fragment, counted in the packet completed by the last one
+                return;
+            }
+        }
+
         if(strcmp(msg->getName(),"gtc_hdr_ul") == 0) {        // updating buffer size after receiving requests from SFUs
             gtc_header *pkt = check_and_cast<gtc_header *>(msg);
 
@@ -103,19 +199,20 @@ void MFU::handleMessage(cMessage *msg)
             int index = sfuId % sfus;
             // for T-CONT 2
             sfu_buffer_TC2[index] = pkt->getBufferOccupancyTC2();
-            EV << "[mfu" << getIndex() << "] updated sfu_buffer_TC2[" << sfuId << "] = " << sfu_buffer_TC2[sfuId] << endl;
+            EV << "[mfu" << getIndex() << "] updated sfu_buffer_TC2[" << index << "] = " << sfu_buffer_TC2[index] << endl;
             // for T-CONT 3
             sfu_buffer_TC3[index] = pkt->getBufferOccupancyTC3();
-            EV << "[mfu" << getIndex() << "] updated sfu_buffer_TC3[" << sfuId << "] = " << sfu_buffer_TC3[sfuId] << endl;
+            EV << "[mfu" << getIndex() << "] updated sfu_buffer_TC3[" << index << "] = " << sfu_buffer_TC3[index] << endl;
 
             delete pkt;         // nothing more to do with the header
         }
-        else if(strcmp(msg->getName(),"bkg_data") == 0) {        // updating buffer size after receiving requests from SFUs
+        else if((strcmp(msg->getName(),"bkg_data") == 0)||(strcmp(msg->getName(),"bkg_fluid") == 0)) {        // updating buffer size after receiving requests from SFUs
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
 
             int sfuId = pkt->getSfuId();
             int tcId = pkt->getTContId();
             pkt->setMfuId(getIndex());
+            pkt->setMfuArrivalTime(pkt->getArrivalTime());
             pkt->setSfuId(sfuId);
             send(pkt,"OnuGate_out");                     // just forward to ONU
 
@@ -127,6 +224,7 @@ void MFU::handleMessage(cMessage *msg)
             int sfuId = pkt->getSfuId();
             int tcId = pkt->getTContId();
             pkt->setMfuId(getIndex());
+            pkt->setMfuArrivalTime(pkt->getArrivalTime());
             pkt->setSfuId(sfuId);
             send(pkt,"OnuGate_out");                     // just forward to ONU
 
@@ -138,6 +236,7 @@ void MFU::handleMessage(cMessage *msg)
             int sfuId = pkt->getSfuId();
             int tcId = pkt->getTContId();
             pkt->setMfuId(getIndex());
+            pkt->setMfuArrivalTime(pkt->getArrivalTime());
             pkt->setSfuId(sfuId);
             send(pkt,"OnuGate_out");                     // just forward to ONU
 
@@ -149,6 +248,7 @@ void MFU::handleMessage(cMessage *msg)
             int sfuId = pkt->getSfuId();
             int tcId = pkt->getTContId();
             pkt->setMfuId(getIndex());
+            pkt->setMfuArrivalTime(pkt->getArrivalTime());
             pkt->setSfuId(sfuId);
             send(pkt,"OnuGate_out");                     // just forward to ONU
 
@@ -160,11 +260,20 @@ void MFU::handleMessage(cMessage *msg)
             int sfuId = pkt->getSfuId();
             int tcId = pkt->getTContId();
             pkt->setMfuId(getIndex());
+            pkt->setMfuArrivalTime(pkt->getArrivalTime());
             pkt->setSfuId(sfuId);
             send(pkt,"OnuGate_out");                     // just forward to ONU
 
             //delete pkt;
         }
+        else if((strcmp(msg->getName(),"xr_dl_data") == 0)||(strcmp(msg->getName(),"hmd_dl_data") == 0)||(strcmp(msg->getName(),"bkg_dl_data") == 0)) {
+            ethPacket *pkt = check_and_cast<ethPacket *>(msg);      // downstream payload from the ONU, wait for the next 10G-PON frame
+            dl_queue.insert(pkt);
+            dl_queue_size += pkt->getByteLength();
+            if((!send_dl_payload->isScheduled())&&(dl_frame_budget > 0)) {
+                scheduleAt(simTime(), send_dl_payload);
+            }
+        }
     }
     else {
         if(strcmp(msg->getName(),"ping") == 0) {
@@ -173,18 +282,18 @@ void MFU::handleMessage(cMessage *msg)
             int sfu_id = png->getSFU_id();
             int adj_fct = getIndex()*sfus;
             EV << "[mfu" << getIndex() << "] adj_fct = " << adj_fct << endl;
-            sfu_rtt[sfu_id-adj_fct] = png->getArrivalTime().dbl();
+            sfu_rtt[sfu_id-adj_fct] = (png->getArrivalTime() - png->getSendTime()).dbl();
 
             EV << "[mfu" << getIndex() << "] Received ping response from SFU-" << sfu_id << " and RTT = " << sfu_rtt[sfu_id-adj_fct] << endl;
             EV << "[mfu" << getIndex() << "] sfu_rtt[0] = " << sfu_rtt[0] << ", sfu_rtt[1] = " << sfu_rtt[1] << endl;
             //EV << "[mfu" << getIndex() << "] onu_rtt[2] = " << onu_rtt[2] << ", onu_rtt[3] = " << onu_rtt[3] << endl;
 
-            if(ping_count == sfus) {
+            if(ping_count == sfus) {                                // first ranging complete, later rangings only update sfu_rtt
                 //EV << "[mfu" << getIndex() << "] onu_total_latency[0] = " << onu_total_latency[0] << ", onu_total_latency[1] = " << onu_total_latency[1] << endl;
                 cMessage *schedule_dl_gtc = new cMessage("schedule_dl_gtc");
                 scheduleAt(simTime(), schedule_dl_gtc);           // when ping from all SFUs arrive, initiate the grant scheduling process
 
-                sfu_max_grant = floor((max_polling_cycle - T_guard*sfus)*(int_pon_link_datarate/sfus)/8);  // in Bytes
+                sfu_max_grant = floor((pon.maxPollingCycle - t_guard*sfus)*(pon.intPonPayloadRate/sfus)/8);  // in Bytes
                 //EV << "[mfu" << getIndex() << "] worst_rtt = " << worst_rtt << ", onu_max_grant = " << onu_max_grant << endl;
                 for(int i = 0;i<sfus;i++) {
                     sfu_grant_TC3[i]  = sfu_max_grant;       // initializing all SFUs with maximum grant value
@@ -194,7 +303,10 @@ void MFU::handleMessage(cMessage *msg)
             delete png;
         }
         else if(strcmp(msg->getName(),"schedule_dl_gtc") == 0) {        // calculating the time-instants for sending grants to sfus
-            scheduleAt(simTime()+(simtime_t)125e-6, msg);                          // schedule the self-message after 125 usec
+            scheduleAt(simTime()+(simtime_t)pon.maxPollingCycle, msg);             // schedule the self-message after one cycle (125 usec)
+            if(telemetry != nullptr && telemetry->due(getIndex())) {
+                publishTelemetry();
+            }
 
             gtc_header *gtc_hdr_dl = new gtc_header("gtc_hdr_dl");
             gtc_hdr_dl->setMfuID(getIndex());
@@ -216,6 +328,8 @@ void MFU::handleMessage(cMessage *msg)
             gtc_hdr_dl->setSfu_grant_TC3ArraySize(sfus);
 
             double worst_rtt = *std::max_element(sfu_rtt.begin(), sfu_rtt.end());
+            teqd = (teqd_fixed >= 0) ? std::max(teqd_fixed, worst_rtt) : worst_rtt + response_time;     // the farthest SFU answers without extra delay
+            gtc_hdr_dl->setTeqd(teqd);
             double tx_start = 0;
 
             for(int i = 0;i<sfus;i++) {
@@ -228,34 +342,141 @@ void MFU::handleMessage(cMessage *msg)
                 //sfu_grant_TC3[i] = sfu_max_grant/2;
 
                 // filling into the header packet for T-CONT 2
-                sfu_start_time_TC2[i] = tx_start + T_guard;
+                sfu_start_time_TC2[i] = tx_start + t_guard;
                 gtc_hdr_dl->setSfu_start_time_TC2(i, sfu_start_time_TC2[i]);
                 gtc_hdr_dl->setSfu_grant_TC2(i, sfu_grant_TC2[i]);
                 // filling into the header packet for T-CONT 3
-                sfu_start_time_TC3[i] = tx_start + T_guard + (sfu_grant_TC2[i]*8/int_pon_link_datarate);
+                sfu_start_time_TC3[i] = tx_start + t_guard + (sfu_grant_TC2[i]*8/pon.intPonPayloadRate);
                 gtc_hdr_dl->setSfu_start_time_TC3(i, sfu_start_time_TC3[i]);
                 gtc_hdr_dl->setSfu_grant_TC3(i, sfu_grant_TC3[i]);
                 // shifting the tx_start cursor
-                tx_start += T_guard + (sfu_grant_TC2[i]*8/int_pon_link_datarate) + (sfu_grant_TC3[i]*8/int_pon_link_datarate);
+                tx_start += t_guard + (sfu_grant_TC2[i]*8/pon.intPonPayloadRate) + (sfu_grant_TC3[i]*8/pon.intPonPayloadRate);
 
-                EV << "[mfu" << getIndex() << "] sfu_start_time_TC2[" << i << "] = " << simTime().dbl()+2*125e-6+sfu_start_time_TC2[i]-(worst_rtt/2) << " for seqID = " << seqID << endl;
-                EV << "[mfu" << getIndex() << "] sfu_start_time_TC3[" << i << "] = " << simTime().dbl()+2*125e-6+sfu_start_time_TC3[i]-(worst_rtt/2) << " for seqID = " << seqID << endl;
+                EV << "[mfu" << getIndex() << "] sfu_start_time_TC2[" << i << "] = " << simTime().dbl()+teqd+sfu_start_time_TC2[i] << " for seqID = " << seqID << endl;
+                EV << "[mfu" << getIndex() << "] sfu_start_time_TC3[" << i << "] = " << simTime().dbl()+teqd+sfu_start_time_TC3[i] << " for seqID = " << seqID << endl;
             }
-            EV << "[mfu" << getIndex() << "] last SFU tx finish time = " << simTime().dbl()+2*125e-6+sfu_start_time_TC3[sfus-1]-(worst_rtt/2)+(sfu_grant_TC3[sfus-1]*8/int_pon_link_datarate) << " for seqID = " << seqID << endl;
+            EV << "[mfu" << getIndex() << "] last SFU tx finish time = " << simTime().dbl()+teqd+sfu_start_time_TC3[sfus-1]+(sfu_grant_TC3[sfus-1]*8/pon.intPonPayloadRate) << " for seqID = " << seqID << endl;
 
-            send(gtc_hdr_dl,"SpltGate_o");          // sending the downlink GTC header to SFUs
+            cChannel *dl_ch = gate("SpltGate_o")->getChannel();
+            if(dl_ch->isBusy() == false) {
+                send(gtc_hdr_dl,"SpltGate_o");          // sending the downlink GTC header to SFUs
+            }
+            else {                                      // last payload of the previous frame is still on the fibre
+                sendDelayed(gtc_hdr_dl, dl_ch->getTransmissionFinishTime()-simTime(), "SpltGate_o");
+            }
+            dl_frame_budget = floor(pon.maxPollingCycle*pon.intPonDatarate/8) - gtc_hdr_sz;
 
-            cMessage *send_dl_payload = new cMessage("send_dl_payload");    // send downlink data
-            scheduleAt(simTime(), send_dl_payload);
+            if(!send_dl_payload->isScheduled()) {
+                scheduleAt(simTime(), send_dl_payload);                 // send downlink data
+            }
 
         }
-        else if(strcmp(msg->getName(),"send_dl_payload") == 0) {        // sending the downlink GTC header to SFUs
-            delete msg;         // not doing anything now, just keeping the provision for future
+        else if(strcmp(msg->getName(),"take_snapshot") == 0) {
+            delete msg;
+            takeSnapshot();
+        }
+        else if(strcmp(msg->getName(),"start_ranging") == 0) {          // periodic re-ranging, the responses update sfu_rtt
+            scheduleAt(simTime()+ranging_interval, msg);
+            ping *png = new ping("ping");
+            png->setSendTime(simTime());
+            send(png,"SpltGate_o");
+            rangings++;
+        }
+        else if(strcmp(msg->getName(),"send_dl_payload") == 0) {        // sending the downlink payload to SFUs
+            if(!dl_queue.isEmpty()) {
+                ethPacket *front = (ethPacket *)dl_queue.front();
+                cChannel *dl_ch = gate("SpltGate_o")->getChannel();
+                if(front->getByteLength() > dl_frame_budget) {          // does not fit, wait for the next downstream frame
+                    EV << "[mfu" << getIndex() << "] downstream frame full, " << dl_queue.getLength() << " packets wait for the next frame" << endl;
+                }
+                else if(dl_ch->isBusy() == true) {
+                    scheduleAt(dl_ch->getTransmissionFinishTime(), msg);
+                }
+                else {
+                    ethPacket *pkt = (ethPacket *)dl_queue.pop();
+                    dl_queue_size -= pkt->getByteLength();
+                    dl_frame_budget -= pkt->getByteLength();
+                    send(pkt,"SpltGate_o");
+                    scheduleAt(dl_ch->getTransmissionFinishTime(), msg);
+                }
+            }
         }
     }
 }
 
+void MFU::takeSnapshot()
+{
+    Snapshot snap;
+    snap.put("sfu_rtt", sfu_rtt);
+    snap.put("sfu_buffer_TC2", sfu_buffer_TC2);
+    snap.put("sfu_buffer_TC3", sfu_buffer_TC3);
+    snap.put("sfu_grant_TC2", sfu_grant_TC2);
+    snap.put("sfu_grant_TC3", sfu_grant_TC3);
+    snap.put("seqID", seqID);
+    snap.save(Snapshot::fileName(par("snapshotDir").stringValue(), this));
+    EV << "[mfu" << getIndex() << "] snapshot taken at " << simTime() << endl;
+}
 
+bool MFU::restoreSnapshot()
+{
+    Snapshot snap;
+    if(!snap.load(Snapshot::fileName(par("snapshotDir").stringValue(), this))) {
+        EV << "[mfu" << getIndex() << "] no snapshot found, ranging from scratch" << endl;
+        return false;
+    }
+    vector<double> rtt = snap.getVector("sfu_rtt");
+    if((int)rtt.size() != sfus)
+        throw cRuntimeError("snapshot of %s was taken with %d sfus, not %d", getFullPath().c_str(), (int)rtt.size(), sfus);
+    sfu_rtt = rtt;
+    sfu_buffer_TC2 = snap.getVector("sfu_buffer_TC2");
+    sfu_buffer_TC3 = snap.getVector("sfu_buffer_TC3");
+    sfu_grant_TC2 = snap.getVector("sfu_grant_TC2");
+    sfu_grant_TC3 = snap.getVector("sfu_grant_TC3");
+    seqID = snap.get("seqID");
+    sfu_max_grant = floor((pon.maxPollingCycle - t_guard*sfus)*(pon.intPonPayloadRate/sfus)/8);  // in Bytes
+
+    cMessage *schedule_dl_gtc = new cMessage("schedule_dl_gtc");
+    scheduleAt(simTime(), schedule_dl_gtc);           // the grant scheduling continues right away
+    EV << "[mfu" << getIndex() << "] state restored from snapshot" << endl;
+    return true;
+}
 
+void MFU::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+    recordScalar("equalisationDelay", teqd, "s");
+    recordScalar("rangings", rangings);
+    recordScalar("receivedPackets", totalPacketsReceived);
+    recordScalar("corruptedPackets", corruptedPackets);
+    recordScalar("fecCodewords", fec.codewords);
+    recordScalar("fecLostCodewords", fec.lostCodewords);
+    recordScalar("fecCodewordLossProbability", fec.getCodewordLoss());
+    recordScalar("receivedBits", totalBitsReceived);
+    recordScalar("goodputBits", goodBitsReceived);
+    if(simTime() > 0)
+        recordScalar("goodput", goodBitsReceived/simTime().dbl(), "bps");   // upstream payload delivered error free
+    if(reassemble) {
+        recordScalar("reassembledPackets", reassembly.completed);
+        recordScalar("reassemblyTimeouts", reassembly.timedOut);
+        recordScalar("reassemblyEvictions", reassembly.evicted);
+        recordScalar("orphanFragments", reassembly.orphans);
+        recordScalar("reassemblyPending", reassembly.getPending());
+    }
+}
 
-
+void MFU::publishTelemetry()
+{
+    double *d = telemetry->begin(getIndex());
+    d[0] = simTime().dbl();
+    d[1] = getSimulation()->getEventNumber();
+    d[2] = dl_queue_size;
+    double *e = d + 3 + 3*Telemetry::num_classes;               // no latency statistics at the MFU
+    for(int i = 0; i < sfus; i++) {
+        e[Telemetry::fields*i+0] = sfu_buffer_TC2[i];
+        e[Telemetry::fields*i+1] = sfu_buffer_TC3[i];
+        e[Telemetry::fields*i+2] = sfu_grant_TC2[i];
+        e[Telemetry::fields*i+3] = sfu_grant_TC3[i];
+    }
+    telemetry->end(getIndex());
+}
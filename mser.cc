@@ -0,0 +1,70 @@
+/*
+ * mser.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <algorithm>
+
+#include "mser.h"
+
+void Mser::init(int batchSize, int minBatches)
+{
+    this->batchSize = std::max(1, batchSize);
+    this->minBatches = std::max(4, minBatches);
+    sum = 0;
+    count = 0;
+    means.clear();
+    starts.clear();
+    checked = 0;
+    done = false;
+    truncation_time = 0;
+}
+
+void Mser::add(double t, double value)
+{
+    if(done)
+        return;
+    if(count == 0)
+        batch_start = t;
+    sum += value;
+    if(++count < batchSize)
+        return;
+    means.push_back(sum/count);
+    starts.push_back(batch_start);
+    sum = 0;
+    count = 0;
+
+    // the test is O(k), repeat it only when the series has grown by 10%
+    if(((int)means.size() >= minBatches)&&(means.size() >= checked + std::max<size_t>(1, checked/10))) {
+        checked = means.size();
+        done = test();
+    }
+}
+
+bool Mser::test()
+{
+    size_t k = means.size();
+    double s1 = 0, s2 = 0;                      // suffix sums of Z and Z^2
+    double best = -1;
+    size_t best_d = 0;
+    for(size_t d = k; d-- > 0; ) {
+        s1 += means[d];
+        s2 += means[d]*means[d];
+        size_t n = k - d;
+        if(d > k/2)
+            continue;                           // only truncation points in the first half count
+        double sse = s2 - s1*s1/n;              // sum of squared deviations of Z_{d+1..k}
+        double mser = sse/((double)n*n);
+        if((best < 0)||(mser <= best)) {
+            best = mser;
+            best_d = d;
+        }
+    }
+    // d* at the very end of the allowed range means the transient may still be going on
+    if(best_d >= k/2)
+        return false;
+    truncation_time = starts[best_d];
+    return true;
+}
@@ -0,0 +1,44 @@
+/*
+ * mser.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef MSER_H_
+#define MSER_H_
+
+#include <stddef.h>
+#include <vector>
+
+/*
+ * MSER-m warm-up detection on one output series. Samples are averaged in batches of m (m = 5
+ * for MSER-5) and the truncation point d* minimises the standard error of the remaining batch
+ * means, sum_{i>d}(Z_i - mean_d)^2 / (k-d)^2. The series counts as past its transient once d*
+ * falls in the first half of the k batches collected so far.
+ */
+class Mser
+{
+    private:
+        int batchSize = 5;
+        int minBatches = 100;
+        double sum = 0;                         // current batch
+        int count = 0;
+        double batch_start = 0;
+        std::vector<double> means;              // batch means Z_1..Z_k
+        std::vector<double> starts;             // time of the first sample of every batch
+        size_t checked = 0;                     // batches at the last test
+        bool done = false;
+        double truncation_time = 0;
+
+        bool test();
+
+    public:
+        void init(int batchSize, int minBatches);
+        void add(double t, double value);
+        bool isDone() const { return done; }
+        double getTruncationTime() const { return truncation_time; }
+        int getBatches() const { return means.size(); }
+};
+
+#endif /* MSER_H_ */
@@ -0,0 +1,94 @@
+/*
+ * occupancy_sampler.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <algorithm>
+
+#include "occupancy_sampler.h"
+
+void OccupancySampler::init(const char *name, double bucketWidth, int maxPoints)
+{
+    this->name = name;
+    width = bucketWidth;
+    this->maxPoints = std::max(2, maxPoints + maxPoints%2);        // even, so merged buckets stay aligned
+    buckets.clear();
+    buckets.reserve(this->maxPoints);
+    last_value = 0;
+    last_time = 0;
+    openBucket(0);
+}
+
+void OccupancySampler::openBucket(double start)
+{
+    current.start = start;
+    current.min = last_value;                   // occupancy carried over from the previous bucket
+    current.max = last_value;
+    current.area = 0;
+    current.covered = 0;
+}
+
+void OccupancySampler::closeBucket()
+{
+    buckets.push_back(current);
+    if((int)buckets.size() < maxPoints)
+        return;
+
+    // reservoir is full: merge adjacent buckets and double the bucket width
+    size_t j = 0;
+    for(size_t i = 0; i+1 < buckets.size(); i += 2) {
+        Bucket b = buckets[i];
+        b.min = std::min(b.min, buckets[i+1].min);
+        b.max = std::max(b.max, buckets[i+1].max);
+        b.area += buckets[i+1].area;
+        b.covered += buckets[i+1].covered;
+        buckets[j++] = b;
+    }
+    buckets.resize(j);
+    width *= 2;
+}
+
+void OccupancySampler::advance(double now)
+{
+    while(now >= current.start + width) {       // close every bucket that ended before now
+        double end = current.start + width;
+        current.area += last_value*(end - last_time);
+        current.covered += end - last_time;
+        last_time = end;
+        closeBucket();
+        openBucket(end);
+    }
+    current.area += last_value*(now - last_time);
+    current.covered += now - last_time;
+    last_time = now;
+}
+
+void OccupancySampler::update(simtime_t now, double value)
+{
+    if(width <= 0)
+        return;
+    advance(now.dbl());
+    last_value = value;
+    current.min = std::min(current.min, value);
+    current.max = std::max(current.max, value);
+}
+
+void OccupancySampler::record(simtime_t now)
+{
+    if(width <= 0)
+        return;
+    advance(now.dbl());
+    if(current.covered > 0)
+        buckets.push_back(current);             // partial last bucket
+
+    cOutVector min_vec((name + " min").c_str());
+    cOutVector mean_vec((name + " mean").c_str());
+    cOutVector max_vec((name + " max").c_str());
+    for(auto &b : buckets) {
+        min_vec.recordWithTimestamp(b.start, b.min);
+        mean_vec.recordWithTimestamp(b.start, b.area/b.covered);
+        max_vec.recordWithTimestamp(b.start, b.max);
+    }
+}
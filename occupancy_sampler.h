@@ -0,0 +1,52 @@
+/*
+ * occupancy_sampler.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef OCCUPANCY_SAMPLER_H_
+#define OCCUPANCY_SAMPLER_H_
+
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/*
+ * Keeps the min, time-weighted mean and max of a queue occupancy per time bucket.
+ * When maxPoints buckets are full, adjacent buckets are merged pairwise and the
+ * bucket width doubles, so memory stays bounded for any simulation length.
+ */
+class OccupancySampler
+{
+    private:
+        struct Bucket
+        {
+            double start;                       // bucket start time (s)
+            double min;
+            double max;
+            double area;                        // integral of occupancy over the bucket (Bytes x s)
+            double covered;                     // time covered by the bucket so far (s)
+        };
+
+        std::string name;
+        double width = 0;                       // current bucket width (s), 0 = disabled
+        int maxPoints = 0;
+        std::vector<Bucket> buckets;            // closed buckets
+        Bucket current;
+        double last_value = 0;                  // occupancy since last_time
+        double last_time = 0;
+
+        void openBucket(double start);
+        void closeBucket();
+        void advance(double now);
+
+    public:
+        void init(const char *name, double bucketWidth, int maxPoints);
+        void update(simtime_t now, double value);
+        void record(simtime_t now);
+};
+
+#endif /* OCCUPANCY_SAMPLER_H_ */
@@ -12,9 +12,18 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
+#include "snapshot.h"
+#include "batch_means.h"
+#include "mser.h"
+#include "column_writer.h"
+#include "lifecycle_trace.h"
+#include "telemetry.h"
+#include "reassembly.h"
+#include "fec.h"
 
 using namespace std;
 using namespace omnetpp;
@@ -22,7 +31,12 @@ using namespace omnetpp;
 class OLT : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        PonParams pon;                          // PON dimensioning of this run
         //cQueue olt_queue;
+        cQueue dl_queue;                        // downstream payload waiting for the next downstream frames
+        double dl_queue_size = 0;
+        double dl_frame_budget = 0;             // bytes left in the current downstream frame
         vector<double> onu_rtt;
         vector<double> onu_buffer_TC1;
         vector<double> onu_buffer_TC2;
@@ -40,8 +54,72 @@ class OLT : public cSimpleModule
         long seqID = 0;
 
         int onus;
+        int sfus;                               // SFUs per ONU
+        int xrs;                                // XR devices per ONU
         int ping_count = 0;
-        double onu_max_grant;
+        double t_guard;                         // guard time between bursts, shrunk for very large splits
+        double response_time;                   // ONU processing time between a grant and its burst
+        double teqd_fixed;                      // configured Teqd, -1 = derived from the worst RTT
+        double teqd = 0;                        // equalisation delay of the current cycle, every burst arrives Teqd + start time after its grant
+        double ranging_interval;
+        long rangings = 0;
+
+        // TWDM upstream: every wavelength carries extPonDatarate with its own TDMA schedule in the polling cycle
+        int wavelengths;
+        vector<int> onu_wavelength;
+        vector<double> wl_max_grant;            // per wavelength, shared by the ONUs on it (Bytes)
+        vector<double> onu_load;                // smoothed reported backlog, drives the rebalancing
+        vector<int> onu_tuning;                 // cycles an ONU still needs to retune its transmitter
+        int rebalance_cycles;
+        double rebalance_threshold;
+        int tuning_cycles;
+        long wl_moves = 0;
+        vector<double> wl_granted;              // bytes granted per wavelength
+
+        // downstream traffic generation
+        bool downstream;
+        double dl_xr_datarate;
+        double dl_xr_framerate;
+        double dl_hmd_ack_size;
+        double dl_bkg_arrival_rate;             // aggregate arrival rate of all downstream background flows
+        vector<cMessage *> dl_xr_events;        // one frame timer per XR device
+        cMessage *dl_bkg_event = nullptr;
+        cMessage *send_dl_payload = nullptr;    // drains dl_queue within the current downstream frame
+        long dl_packets_sent = 0;
+        double bkg_fluid_bytes = 0;             // background volume received as fluid bursts
+
+        // convergence monitor: stop once the latency estimates are precise enough
+        bool ciStop;
+        double ci_target;                       // relative CI half-width to reach
+        int ci_min_batches;
+        vector<string> ci_class_names = {"xr", "hmd", "ctrl", "hptc", "bkg"};
+        vector<bool> ci_watch;                  // classes that must converge
+        vector<BatchMeans> ci_monitor;          // one per traffic class, same order as ci_class_names
+        simtime_t ci_converged_at = -1;
+
+        // warm-up detection: latency statistics are only emitted once every monitored series is past its transient
+        bool mserWarmup;
+        bool steady = true;
+        vector<Mser> mser_series;
+        vector<int> mser_latency_series;        // per traffic class: index into mser_series, -1 = not monitored
+        int mser_queue_series = -1;             // total reported TC2+TC3 backlog, sampled once per cycle
+        simtime_t warmup_period = 0;
+        simtime_t warmup_detected_at = -1;
+
+        ColumnWriter col_out;                   // binary per-packet results, open when columnarOutput is set
+        LifecycleTrace lifecycle;               // raw timestamps of every received packet, open when lifecycleTrace is set
+        bool reassemble;
+        Reassembly reassembly;                  // ONU fragments, a packet counts once its last fragment has arrived
+
+        // per-hop latency decomposition: one histogram per traffic class and hop, same log bins in every run
+        bool hopHistograms;
+        vector<string> hop_names = {"wireless", "sfu", "int_pon", "mfu", "onu", "ext_pon"};
+        vector<cHistogram *> hop_hist;          // [class*hop_names.size() + hop]
+
+        // live telemetry: DBA tables and running latency percentiles over the last samples of every class
+        Telemetry *telemetry = nullptr;
+        vector<vector<double>> tel_latency;     // per class: ring of the most recent latencies
+        vector<long> tel_samples;
 
         //simsignal_t errorSignal;
         simsignal_t latencySignalXr;
@@ -51,24 +129,61 @@ class OLT : public cSimpleModule
         simsignal_t latencySignalBkg;
 
     public:
-        //virtual ~OLT();
+        virtual ~OLT();
 
     protected:
         double ber;
         long totalBitsReceived = 0;
+        long goodBitsReceived = 0;              // received bits outside lost codewords
         long totalPacketsReceived = 0;
         long corruptedPackets = 0;
+        Fec fec;                                // lost codewords of the upstream bursts
 
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void takeSnapshot();
+        virtual bool restoreSnapshot();
+        virtual void finish() override;
         //virtual ponPacket *generateGrantPacket();
+        virtual void enqueueDownstream(const char *name, int sfuId, int deviceId, double size);
+        virtual void observeLatency(int cls, double latency);
+        virtual void emitLatency(int cls, simsignal_t signal, ethPacket *pkt, double latency);
+        virtual void checkWarmup();
+        virtual void traceLifecycle(ethPacket *pkt);
+        virtual void collectHops(int cls, ethPacket *pkt);
+        virtual void publishTelemetry();
+        virtual void updateMaxGrants();
+        virtual void rebalanceWavelengths();
 };
 
 Define_Module(OLT);
 
+OLT::~OLT()
+{
+    for(auto ev : dl_xr_events) {
+        cancelAndDelete(ev);
+    }
+    cancelAndDelete(dl_bkg_event);
+    cancelAndDelete(send_dl_payload);
+    while (!dl_queue.isEmpty()) {
+        delete dl_queue.pop();
+    }
+    for(auto h : hop_hist) {
+        delete h;
+    }
+    Telemetry::detach(telemetry);
+}
+
 void OLT::initialize()
 {
+    pon.read(getParentModule());
+    wavelengths = par("wavelengths");
+    if(wavelengths < 1)
+        throw cRuntimeError("wavelengths must be at least 1");
+    check_and_cast<cDatarateChannel *>(gate("SpltGate_i")->getPreviousGate()->getChannel())->setDatarate(wavelengths*pon.extPonPayloadRate);   // splitter-OLT fibre, FEC parity excluded, all wavelengths
+    ber = par("ber");
+    fec.init(pon.extPonFec, ber, getRNG(rng_fec));
     //errorSignal = registerSignal("pkt_error");  // registering the signal
     latencySignalXr = registerSignal("xr_latency");
     latencySignalHmd = registerSignal("hmd_latency");
@@ -80,7 +195,86 @@ void OLT::initialize()
 
     gate("SpltGate_i")->setDeliverImmediately(true);
 
+    ciStop = par("ciStop");
+    if(ciStop) {
+        ci_target = par("ciTarget");
+        ci_min_batches = par("ciMinBatches");
+        vector<double> percentiles = cStringTokenizer(par("ciPercentiles").stringValue()).asDoubleVector();
+        vector<string> watched = cStringTokenizer(par("ciClasses").stringValue()).asVector();
+        ci_monitor.resize(ci_class_names.size());
+        ci_watch.resize(ci_class_names.size(), false);
+        for(size_t c = 0; c < ci_class_names.size(); c++) {
+            ci_monitor[c].init(percentiles, par("ciBatchSize"));
+            ci_watch[c] = std::find(watched.begin(), watched.end(), ci_class_names[c]) != watched.end();
+        }
+    }
+
+    mserWarmup = par("mserWarmup");
+    mser_latency_series.resize(ci_class_names.size(), -1);
+    if(mserWarmup) {
+        steady = false;
+        vector<string> series = cStringTokenizer(par("mserSeries").stringValue()).asVector();
+        for(auto &name : series) {
+            Mser m;
+            m.init(par("mserBatchSize"), par("mserMinBatches"));
+            mser_series.push_back(m);
+            if(name == "queue") {
+                mser_queue_series = mser_series.size()-1;
+            }
+            else {
+                auto it = std::find(ci_class_names.begin(), ci_class_names.end(), name);
+                if(it == ci_class_names.end())
+                    throw cRuntimeError("unknown mserSeries entry '%s'", name.c_str());
+                mser_latency_series[it - ci_class_names.begin()] = mser_series.size()-1;
+            }
+        }
+        steady = mser_series.empty();
+    }
+
+    string col_path = par("columnarOutput").stdstringValue();
+    if(!col_path.empty()) {
+        // one row per latency sample: arrival time, flow, class, end-to-end latency and the delay of every hop
+        vector<string> names = {"time", "flow", "class", "sfu", "latency", "wifi", "wap", "drop", "sfu_queue", "int_pon", "onu_queue", "ext_pon"};
+        if(!col_out.open(col_path, names, "dibidfffffff", par("columnarBlockRows").intValue(), par("columnarCompress")))
+            throw cRuntimeError("cannot open columnar output file '%s'", col_path.c_str());
+        if(par("columnarCompress").boolValue() && !ColumnWriter::canCompress())
+            EV_WARN << "[olt] columnarCompress is set but this build has no zlib (FTTR_WITH_ZLIB), writing raw blocks" << endl;
+    }
+
+    hopHistograms = par("hopHistograms");
+    if(hopHistograms) {
+        // fixed logarithmic bins from 10 ns to 1 s, 10 per decade: histograms of different runs can be merged bin by bin
+        vector<double> edges;
+        for(int k = 0; k <= 80; k++) {
+            edges.push_back(1e-8*pow(10.0, k/10.0));
+        }
+        for(auto &cls : ci_class_names) {
+            for(auto &hop : hop_names) {
+                cHistogram *h = new cHistogram((cls + " " + hop + " delay").c_str(), (cIHistogramStrategy *)nullptr);
+                h->setBinEdges(edges);
+                hop_hist.push_back(h);
+            }
+        }
+    }
+
+    string telemetry_name = getParentModule()->par("telemetry").stdstringValue();
+    if(!telemetry_name.empty()) {
+        telemetry = Telemetry::attach(telemetry_name, par("NumberOfONUs"), getParentModule()->par("NumberOfSFUs"),
+                                      getParentModule()->par("telemetryInterval"));
+        tel_latency.resize(ci_class_names.size());
+        tel_samples.resize(ci_class_names.size(), 0);
+    }
+
+    reassemble = par("reassembly");
+    reassembly.init(par("reassemblyTimeout").doubleValue(), par("reassemblyMaxPending").intValue());
+
+    string lifecycle_path = par("lifecycleTrace").stdstringValue();
+    if(!lifecycle_path.empty()) {
+        lifecycle.open(lifecycle_path, par("lifecycleCapacity").intValue(), par("lifecycleRing"));
+    }
+
     onus = par("NumberOfONUs");
+    t_guard = std::min(pon.guardTime, pon.maxPollingCycle/(2*onus));      // guards never take more than half of the cycle
     EV << "[olt] No. of ONUs detected = " << onus << endl;
 
     onu_rtt.resize(onus,0);
@@ -98,17 +292,96 @@ void OLT::initialize()
         onu_index.push_back(j);
     }
 
+    for(int j = 0; j<onus; j++) {
+        onu_wavelength.push_back(j % wavelengths);            // round robin until the first rebalancing
+    }
+    onu_load.resize(onus,0);
+    onu_tuning.resize(onus,0);
+    wl_max_grant.resize(wavelengths,0);
+    wl_granted.resize(wavelengths,0);
+    rebalance_cycles = par("rebalanceCycles");
+    rebalance_threshold = par("rebalanceThreshold");
+    tuning_cycles = (int)ceil(par("tuningTime").doubleValueInUnit("s")/pon.maxPollingCycle);
+
+    sfus = getParentModule()->par("NumberOfSFUs");
+    xrs = getParentModule()->par("NumberOfXRs");
+    dl_queue.setName("dl_queue");
+    send_dl_payload = new cMessage("send_dl_payload");
+    downstream = par("downstream");
+    if(downstream) {
+        dl_xr_datarate = par("dlXrDataRate");
+        dl_xr_framerate = par("dlXrFrameRate");
+        dl_hmd_ack_size = par("dlHmdAckSize");
+        // each of the 3 background devices behind every SFU receives dlBkgLoad of dlBkgDataRate
+        double bkg_flows = 3.0*onus*sfus;
+        dl_bkg_arrival_rate = bkg_flows*(double)par("dlBkgLoad")*(double)par("dlBkgDataRate")/(8*pkt_sz_avg);
+
+        for(int x = 0; x < onus*xrs; x++) {                 // rendered video frames towards every XR headset
+            cMessage *ev = new cMessage("dl_xr_frame");
+            ev->setKind(x);
+            scheduleAt(simTime()+uniform(0,1.0/dl_xr_framerate,rng_arrival), ev);
+            dl_xr_events.push_back(ev);
+        }
+        if(dl_bkg_arrival_rate > 0) {
+            dl_bkg_event = new cMessage("dl_bkg_gen");
+            scheduleAt(simTime()+exponential(1/dl_bkg_arrival_rate, rng_dl_bkg_arrival), dl_bkg_event);
+        }
+    }
+
     //EV << "[olt] onu_rtt[0] = " << onu_rtt[0] << ", onu_rtt[1] = " << onu_rtt[1] << endl;
     // bw_map = [onu_id, tc_type, start_time, grant_size]
 
+    double snapshot_at = par("snapshotAt");
+    if(snapshot_at >= 0) {
+        scheduleAt(snapshot_at, new cMessage("take_snapshot"));
+    }
+    response_time = par("responseTime").doubleValueInUnit("s");
+    teqd_fixed = par("equalisationDelay").doubleValueInUnit("s");
+    ranging_interval = par("rangingInterval").doubleValueInUnit("s");
+    if(ranging_interval > 0) {
+        scheduleAt(simTime()+ranging_interval, new cMessage("start_ranging"));
+    }
+    if(par("restoreSnapshot").boolValue() && restoreSnapshot()) {
+        return;                         // ranging is skipped, the RTT table comes from the snapshot
+    }
+
     ping *png = new ping("ping");      // sending ping message at T = 0 for finding the RTT of all ONUs
+    png->setSendTime(simTime());
     send(png,"SpltGate_o");
+    rangings++;
     EV << "[olt] Sending ping from OLT at = " << simTime() << endl;
 }
 
 void OLT::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(dl_queue.getLength());
     if(msg->isPacket() == true) {
+        if(strcmp(msg->getName(),"gtc_hdr_ul") == 0) {
+            fec.startBurst();           // every ONU burst starts with its report in a new codeword
+        }
+        totalPacketsReceived++;
+        totalBitsReceived += check_and_cast<cPacket *>(msg)->getBitLength();
+        if(fec.corrupts(check_and_cast<cPacket *>(msg)->getBitLength())) {
+            corruptedPackets++;         // a lost codeword covers part of it, the packet is lost
+            if(reassemble && (dynamic_cast<ethPacket *>(msg) != nullptr))
+                reassembly.discard(check_and_cast<ethPacket *>(msg));
+            delete msg;
+            return;
+        }
+        goodBitsReceived += check_and_cast<cPacket *>(msg)->getBitLength();
+
+        if(reassemble && (dynamic_cast<ethPacket *>(msg) != nullptr)) {
+            if(!reassembly.add(check_and_cast<ethPacket *>(msg))) {
+                delete msg;             // leading fragment, latency and bytes are taken from the completed packet
+                return;
+            }
+        }
+        if(lifecycle.isOpen() && dynamic_cast<ethPacket *>(msg) != nullptr) {
+            traceLifecycle(check_and_cast<ethPacket *>(msg));
+        }
+
         if(strcmp(msg->getName(),"gtc_hdr_ul") == 0) {                  // updating buffer size after receiving requests from ONUs
             gtc_header *pkt = check_and_cast<gtc_header *>(msg);
 
@@ -133,10 +406,15 @@ void OLT::handleMessage(cMessage *msg)
             if((onuId==0) && (mfuId==0)) {                          // Background from random devices at all SFUs
                 double bkg_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
                 EV << "[olt] background packet_latency: " << bkg_packet_latency << endl;
-                emit(latencySignalBkg, bkg_packet_latency);
+                emitLatency(4, latencySignalBkg, pkt, bkg_packet_latency);
             }
             delete pkt;
         }
+        else if(strcmp(msg->getName(),"bkg_fluid") == 0) {       // fluid background burst, only its volume matters
+            ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+            bkg_fluid_bytes += pkt->getByteLength();
+            delete pkt;
+        }
         else if(strcmp(msg->getName(),"xr_data") == 0) {
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
 
@@ -145,10 +423,10 @@ void OLT::handleMessage(cMessage *msg)
             int mfuId = pkt->getMfuId();
             int tcId = pkt->getTContId();
 
-            if((onuId==0) && (mfuId==0) && ((sfuId%2)==0)) {            // XR from robots at odd SFUs
+            if((onuId==0) && (mfuId==0) && (((sfuId%sfus)%2)==0)) {            // XR from robots at odd SFUs
                 double xr_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
                 EV << "[olt] XR packet_latency: " << xr_packet_latency << endl;
-                emit(latencySignalXr, xr_packet_latency);
+                emitLatency(0, latencySignalXr, pkt, xr_packet_latency);
             }
             delete pkt;
         }
@@ -160,10 +438,10 @@ void OLT::handleMessage(cMessage *msg)
             int mfuId = pkt->getMfuId();
             int tcId = pkt->getTContId();
 
-            if((onuId==0) && (mfuId==0) && ((sfuId%2)==0)) {            // Haptics from robots at odd SFUs
+            if((onuId==0) && (mfuId==0) && (((sfuId%sfus)%2)==0)) {            // Haptics from robots at odd SFUs
                 double hptc_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
                 EV << "[olt] Haptic packet_latency: " << hptc_packet_latency << endl;
-                emit(latencySignalHpt, hptc_packet_latency);
+                emitLatency(3, latencySignalHpt, pkt, hptc_packet_latency);
             }
             delete pkt;
         }
@@ -175,10 +453,13 @@ void OLT::handleMessage(cMessage *msg)
             int mfuId = pkt->getMfuId();
             int tcId = pkt->getTContId();
 
-            if((onuId==0) && (mfuId==0) && ((sfuId%2)!=0)) {            // HMD from humans at odd SFUs
+            if((onuId==0) && (mfuId==0) && (((sfuId%sfus)%2)!=0)) {            // HMD from humans at odd SFUs
                 double hmd_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
                 EV << "[olt] HMD packet_latency: " << hmd_packet_latency << endl;
-                emit(latencySignalHmd, hmd_packet_latency);
+                emitLatency(1, latencySignalHmd, pkt, hmd_packet_latency);
+            }
+            if(downstream) {                                            // acknowledge the pose update towards the headset
+                enqueueDownstream("hmd_dl_data", sfuId, 0, dl_hmd_ack_size);
             }
             delete pkt;
         }
@@ -190,10 +471,10 @@ void OLT::handleMessage(cMessage *msg)
             int mfuId = pkt->getMfuId();
             int tcId = pkt->getTContId();
 
-            if((onuId==0) && (mfuId==0) && ((sfuId%2)!=0)) {            // Control from humans at odd SFUs
+            if((onuId==0) && (mfuId==0) && (((sfuId%sfus)%2)!=0)) {            // Control from humans at odd SFUs
                 double ctrl_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
                 EV << "[olt] Control packet_latency: " << ctrl_packet_latency << endl;
-                emit(latencySignalCtr, ctrl_packet_latency);
+                emitLatency(2, latencySignalCtr, pkt, ctrl_packet_latency);
             }
             delete pkt;
         }
@@ -203,28 +484,34 @@ void OLT::handleMessage(cMessage *msg)
             ping_count += 1;
             ping *png = check_and_cast<ping *>(msg);
             int onu_id = png->getONU_id();
-            onu_rtt[onu_id] = png->getArrivalTime().dbl();
+            onu_rtt[onu_id] = (png->getArrivalTime() - png->getSendTime()).dbl();
 
             //EV << "[olt] Received ping response from ONU-" << onu_id << " and RTT = " << onu_rtt[onu_id] << endl;
             //EV << "[olt] onu_rtt[0] = " << onu_rtt[0] << ", onu_rtt[1] = " << onu_rtt[1] << endl;
             //EV << "[olt] onu_rtt[2] = " << onu_rtt[2] << ", onu_rtt[3] = " << onu_rtt[3] << endl;
 
-            if(ping_count == onus) {
+            if(ping_count == onus) {                                // first ranging complete, later rangings only update onu_rtt
                 //EV << "[olt] onu_total_latency[0] = " << onu_total_latency[0] << ", onu_total_latency[1] = " << onu_total_latency[1] << endl;
                 cMessage *schedule_dl_gtc = new cMessage("schedule_dl_gtc");
                 scheduleAt(simTime(), schedule_dl_gtc);           // when ping from all ONUs arrive, initiate the grant scheduling process
 
-                onu_max_grant = floor((max_polling_cycle - T_guard*onus)*(ext_pon_link_datarate/onus)/8);  // in Bytes
-                //EV << "[olt] worst_rtt = " << worst_rtt << ", onu_max_grant = " << onu_max_grant << endl;
+                updateMaxGrants();
                 for(int i = 0;i<onus;i++) {
-                    onu_grant_TC3[i] = onu_max_grant;       // initializing all ONUs with maximum grant value
-                    onu_buffer_TC3[i] = onu_max_grant;
+                    onu_grant_TC3[i] = wl_max_grant[onu_wavelength[i]];       // initializing all ONUs with maximum grant value
+                    onu_buffer_TC3[i] = wl_max_grant[onu_wavelength[i]];
                 }
             }
             delete png;
         }
         else if(strcmp(msg->getName(),"schedule_dl_gtc") == 0) {        // calculating the time-instants for sending grants to onus
-            scheduleAt(simTime()+(simtime_t)125e-6, msg);                          // schedule the self-message after 125 usec
+            scheduleAt(simTime()+(simtime_t)pon.maxPollingCycle, msg);             // schedule the self-message after one cycle (125 usec)
+            if(telemetry != nullptr && telemetry->due(-1)) {
+                publishTelemetry();
+                if(telemetry->stopRequested()) {
+                    EV << "[olt] stop requested by the telemetry viewer at " << simTime() << endl;
+                    endSimulation();
+                }
+            }
 
             gtc_header *gtc_hdr_dl = new gtc_header("gtc_hdr_dl");
             double us_bw_map_sz = onus*8;                                  // (N x 8) Bytes
@@ -245,43 +532,452 @@ void OLT::handleMessage(cMessage *msg)
             gtc_hdr_dl->setOnu_grant_TC3ArraySize(onus);
 
             double worst_rtt = *std::max_element(onu_rtt.begin(), onu_rtt.end());
-            double tx_start = 0;
+            teqd = (teqd_fixed >= 0) ? std::max(teqd_fixed, worst_rtt) : worst_rtt + response_time;     // the farthest ONU answers without extra delay
+            gtc_hdr_dl->setTeqd(teqd);
+            if((wavelengths > 1)&&(rebalance_cycles > 0)&&(seqID % rebalance_cycles == 0)) {
+                rebalanceWavelengths();
+            }
+            vector<double> wl_tx_start(wavelengths, 0);
 
             for(int i = 0;i<onus;i++) {
+                double &tx_start = wl_tx_start[onu_wavelength[i]];              // every wavelength has its own burst sequence
+                double onu_max_grant = (onu_tuning[i] > 0) ? 0 : wl_max_grant[onu_wavelength[i]];     // no grant while retuning
+                if(onu_tuning[i] > 0)
+                    onu_tuning[i]--;
+                onu_load[i] = 0.9*onu_load[i] + 0.1*(onu_buffer_TC2[i] + onu_buffer_TC3[i]);
                 double onu_max_grant_TC2 = (onu_buffer_TC2[i]/(onu_buffer_TC2[i]+onu_buffer_TC3[i]))*onu_max_grant;
                 double onu_max_grant_TC3 = (1-(onu_buffer_TC2[i]/(onu_buffer_TC2[i]+onu_buffer_TC3[i])))*onu_max_grant;
 
                 onu_grant_TC2[i] = std::min(onu_buffer_TC2[i],onu_max_grant_TC2);      // granting BW using limited service policy
                 onu_grant_TC3[i] = std::min(onu_buffer_TC3[i],onu_max_grant_TC3);
+                wl_granted[onu_wavelength[i]] += onu_grant_TC2[i] + onu_grant_TC3[i];
                 //onu_grant_TC2[i] = onu_max_grant/2;                             // granting BW using fixed service policy
                 //onu_grant_TC3[i] = onu_max_grant/2;
 
                 // filling into the header packet for T-CONT 2
-                onu_start_time_TC2[i] = tx_start + T_guard;
+                onu_start_time_TC2[i] = tx_start + t_guard;
                 gtc_hdr_dl->setOnu_start_time_TC2(i, onu_start_time_TC2[i]);
                 gtc_hdr_dl->setOnu_grant_TC2(i, onu_grant_TC2[i]);
                 // filling into the header packet for T-CONT 3
-                onu_start_time_TC3[i] = tx_start + T_guard + (onu_grant_TC2[i]*8/ext_pon_link_datarate);
+                onu_start_time_TC3[i] = tx_start + t_guard + (onu_grant_TC2[i]*8/pon.extPonPayloadRate);
                 gtc_hdr_dl->setOnu_start_time_TC3(i, onu_start_time_TC3[i]);
                 gtc_hdr_dl->setOnu_grant_TC3(i, onu_grant_TC3[i]);
                 // shifting the tx_start cursor
-                tx_start += T_guard + (onu_grant_TC2[i]*8/ext_pon_link_datarate) + (onu_grant_TC3[i]*8/ext_pon_link_datarate);
+                tx_start += t_guard + (onu_grant_TC2[i]*8/pon.extPonPayloadRate) + (onu_grant_TC3[i]*8/pon.extPonPayloadRate);
 
-                EV << "[olt] onu_start_time_TC2[" << i << "] = " << simTime().dbl()+2*125e-6+onu_start_time_TC2[i]-(worst_rtt/2) << " for seqID = " << seqID << endl;
-                EV << "[olt] onu_start_time_TC3[" << i << "] = " << simTime().dbl()+2*125e-6+onu_start_time_TC3[i]-(worst_rtt/2) << " for seqID = " << seqID << endl;
+                EV << "[olt] onu_start_time_TC2[" << i << "] = " << simTime().dbl()+teqd+onu_start_time_TC2[i] << " for seqID = " << seqID << endl;
+                EV << "[olt] onu_start_time_TC3[" << i << "] = " << simTime().dbl()+teqd+onu_start_time_TC3[i] << " for seqID = " << seqID << endl;
             }
-            EV << "[olt] last ONU tx finish time = " << simTime().dbl()+2*125e-6+onu_start_time_TC3[onus-1]-(worst_rtt/2)+(onu_grant_TC3[onus-1]*8/ext_pon_link_datarate) << " for seqID = " << seqID << endl;
+            EV << "[olt] last ONU tx finish time = " << simTime().dbl()+teqd+onu_start_time_TC3[onus-1]+(onu_grant_TC3[onus-1]*8/pon.extPonPayloadRate) << " for seqID = " << seqID << endl;
 
-            send(gtc_hdr_dl,"SpltGate_o");          // sending the downlink GTC header to ONUs
+            if((!steady)&&(mser_queue_series >= 0)) {               // reported backlog as a warm-up indicator
+                double backlog = std::accumulate(onu_buffer_TC2.begin(), onu_buffer_TC2.end(), 0.0) + std::accumulate(onu_buffer_TC3.begin(), onu_buffer_TC3.end(), 0.0);
+                mser_series[mser_queue_series].add(simTime().dbl(), backlog);
+                checkWarmup();
+            }
 
-            cMessage *send_dl_payload = new cMessage("send_dl_payload");    // send downlink data
-            scheduleAt(simTime(), send_dl_payload);
+            cChannel *dl_ch = gate("SpltGate_o")->getChannel();
+            if(dl_ch->isBusy() == false) {
+                send(gtc_hdr_dl,"SpltGate_o");          // sending the downlink GTC header to ONUs
+            }
+            else {                                      // last payload of the previous frame is still on the fibre
+                sendDelayed(gtc_hdr_dl, dl_ch->getTransmissionFinishTime()-simTime(), "SpltGate_o");
+            }
+            dl_frame_budget = floor(pon.maxPollingCycle*pon.extPonDatarate/8) - gtc_hdr_sz;
+
+            if(!send_dl_payload->isScheduled()) {
+                scheduleAt(simTime(), send_dl_payload);                 // send downlink data
+            }
 
         }
-        else if(strcmp(msg->getName(),"send_dl_payload") == 0) {        // sending the downlink GTC header to ONUs
-            delete msg;         // not doing anything now, just keeping the provision for future
+        else if(strcmp(msg->getName(),"take_snapshot") == 0) {
+            delete msg;
+            takeSnapshot();
+        }
+        else if(strcmp(msg->getName(),"start_ranging") == 0) {          // periodic re-ranging, the responses update onu_rtt
+            scheduleAt(simTime()+ranging_interval, msg);
+            ping *png = new ping("ping");
+            png->setSendTime(simTime());
+            send(png,"SpltGate_o");
+            rangings++;
+        }
+        else if(strcmp(msg->getName(),"send_dl_payload") == 0) {        // sending the downlink payload to ONUs
+            if(!dl_queue.isEmpty()) {
+                ethPacket *front = (ethPacket *)dl_queue.front();
+                cChannel *dl_ch = gate("SpltGate_o")->getChannel();
+                if(front->getByteLength() > dl_frame_budget) {          // does not fit, wait for the next downstream frame
+                    EV << "[olt] downstream frame full, " << dl_queue.getLength() << " packets wait for the next frame" << endl;
+                }
+                else if(dl_ch->isBusy() == true) {
+                    scheduleAt(dl_ch->getTransmissionFinishTime(), msg);
+                }
+                else {
+                    ethPacket *pkt = (ethPacket *)dl_queue.pop();
+                    dl_queue_size -= pkt->getByteLength();
+                    dl_frame_budget -= pkt->getByteLength();
+                    send(pkt,"SpltGate_o");
+                    dl_packets_sent += 1;
+                    scheduleAt(dl_ch->getTransmissionFinishTime(), msg);
+                }
+            }
+        }
+        else if(strcmp(msg->getName(),"dl_xr_frame") == 0) {            // new rendered frame for one XR headset
+            double mean = 1.0/dl_xr_framerate;
+            double std = 2e-3;
+            scheduleAt(simTime()+truncnormal(mean, std, rng_arrival), msg);
+
+            int x = msg->getKind();
+            int sfuId = (x/xrs)*sfus + 2*(x%xrs);                       // XR headsets sit behind the even SFUs
+            double avgFrameSize = dl_xr_datarate/(8*dl_xr_framerate);
+            double frameSize = truncnormal(avgFrameSize, 0.105*avgFrameSize, rng_size);
+            int num_pkts = ceil(frameSize/1500);
+            for(int i=1;i<num_pkts;i++) {
+                enqueueDownstream("xr_dl_data", sfuId, 0, 1542);
+            }
+            int pending = ceil(frameSize-(num_pkts-1)*1500);
+            enqueueDownstream("xr_dl_data", sfuId, 0, min(1500,pending)+42);
+        }
+        else if(strcmp(msg->getName(),"dl_bkg_gen") == 0) {             // aggregate Poisson arrivals of all background flows
+            scheduleAt(simTime()+exponential(1/dl_bkg_arrival_rate, rng_dl_bkg_arrival), msg);
+
+            int sfuId = intuniform(0, onus*sfus-1, rng_dl_bkg_dest);
+            int deviceId = intuniform(1, 3, rng_dl_bkg_dest);
+            enqueueDownstream("bkg_dl_data", sfuId, deviceId, intuniform(64,1542,rng_dl_bkg_size));
         }
     }
 }
 
+void OLT::enqueueDownstream(const char *name, int sfuId, int deviceId, double size)
+{
+    ethPacket *pkt = new ethPacket(name);
+    pkt->setByteLength(size);
+    pkt->setGenerationTime(simTime());
+    pkt->setOnuId(sfuId/sfus);
+    pkt->setMfuId(sfuId/sfus);
+    pkt->setSfuId(sfuId);
+    pkt->setDeviceId(deviceId);
+    dl_queue.insert(pkt);
+    dl_queue_size += pkt->getByteLength();
+    if((!send_dl_payload->isScheduled())&&(dl_frame_budget > 0)) {     // the current frame still has room, no need to wait for the next one
+        scheduleAt(simTime(), send_dl_payload);
+    }
+}
+
+void OLT::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+    recordScalar("totalEvents", (double)getSimulation()->getEventNumber());       // whole-simulation counters for tools/bench.py
+    recordScalar("objectsCreated", (double)cOwnedObject::getTotalObjectCount());
+    recordScalar("objectsLive", (double)cOwnedObject::getLiveObjectCount());
+    if(col_out.isOpen()) {
+        recordScalar("columnarRows", col_out.getRows());
+        col_out.close();
+    }
+    for(auto h : hop_hist) {
+        if(h->getCount() > 0)
+            h->recordAs(h->getName(), "s");
+    }
+    if(lifecycle.isOpen()) {
+        recordScalar("lifecycleRecords", (double)lifecycle.getWritten());
+        lifecycle.close();
+    }
+    recordScalar("receivedPackets", totalPacketsReceived);
+    recordScalar("corruptedPackets", corruptedPackets);
+    recordScalar("fecCodewords", fec.codewords);
+    recordScalar("fecLostCodewords", fec.lostCodewords);
+    recordScalar("fecCodewordLossProbability", fec.getCodewordLoss());
+    recordScalar("receivedBits", totalBitsReceived);
+    recordScalar("goodputBits", goodBitsReceived);
+    if(simTime() > 0)
+        recordScalar("goodput", goodBitsReceived/simTime().dbl(), "bps");   // upstream payload delivered error free
+    if(reassemble) {
+        recordScalar("reassembledPackets", reassembly.completed);
+        recordScalar("reassemblyTimeouts", reassembly.timedOut);
+        recordScalar("reassemblyEvictions", reassembly.evicted);
+        recordScalar("orphanFragments", reassembly.orphans);
+        recordScalar("reassemblyPending", reassembly.getPending());
+    }
+    if(wavelengths > 1) {
+        recordScalar("wavelengthMoves", wl_moves);
+        for(int w = 0; w < wavelengths; w++) {
+            recordScalar(("wavelength " + to_string(w) + " onus").c_str(), std::count(onu_wavelength.begin(), onu_wavelength.end(), w));
+            if(simTime() > 0)
+                recordScalar(("wavelength " + to_string(w) + " utilisation").c_str(), wl_granted[w]*8/(simTime().dbl()*pon.extPonPayloadRate));
+        }
+    }
+    recordScalar("equalisationDelay", teqd, "s");
+    recordScalar("rangings", rangings);
+    recordScalar("dlPacketsSent", dl_packets_sent);
+    recordScalar("dlQueueBytesLeft", dl_queue_size);
+    recordScalar("bkgFluidBytesReceived", bkg_fluid_bytes);
+
+    if(mserWarmup) {
+        recordScalar("warmupPeriod", steady ? warmup_period.dbl() : simTime().dbl());  // whole run if steady state was never detected
+        recordScalar("warmupDetectedAt", warmup_detected_at.dbl());
+    }
+
+    if(ciStop) {
+        recordScalar("ciConvergedAt", ci_converged_at.dbl());         // -1 if the run hit sim-time-limit first
+        for(size_t c = 0; c < ci_monitor.size(); c++) {
+            if(ci_monitor[c].getBatches() == 0)
+                continue;
+            string cls = ci_class_names[c];
+            recordScalar((cls + " ci batches").c_str(), ci_monitor[c].getBatches());
+            for(int i = 0; i < ci_monitor[c].getNumEstimates(); i++) {
+                string est = cls + " latency " + ci_monitor[c].getEstimateName(i);
+                recordScalar(est.c_str(), ci_monitor[c].getEstimate(i));
+                recordScalar((est + " relHalfWidth").c_str(), ci_monitor[c].getRelHalfWidth(i));
+            }
+        }
+    }
+}
+
+void OLT::observeLatency(int cls, double latency)
+{
+    if(!ciStop)
+        return;
+    BatchMeans &m = ci_monitor[cls];
+    int batches = m.getBatches();
+    m.add(latency);
+    if(m.getBatches() == batches)               // only re-check when a batch has been completed
+        return;
+
+    for(size_t c = 0; c < ci_monitor.size(); c++) {
+        if(!ci_watch[c])
+            continue;
+        if((ci_monitor[c].getBatches() < ci_min_batches)||(ci_monitor[c].getMaxRelHalfWidth() > ci_target))
+            return;
+    }
+    ci_converged_at = simTime();
+    EV << "[olt] latency estimates converged at " << simTime() << ", stopping the run" << endl;
+    endSimulation();
+}
+
+void OLT::emitLatency(int cls, simsignal_t signal, ethPacket *pkt, double latency)
+{
+    if(!steady) {
+        int k = mser_latency_series[cls];
+        if(k >= 0) {
+            mser_series[k].add(simTime().dbl(), latency);
+            checkWarmup();
+        }
+        if(!steady)
+            return;                             // samples of the transient are discarded
+    }
+    emit(signal, latency);
+    if(hopHistograms)
+        collectHops(cls, pkt);
+    if(telemetry != nullptr) {
+        vector<double> &ring = tel_latency[cls];
+        if(ring.size() < 4096)
+            ring.push_back(latency);
+        else
+            ring[tel_samples[cls] % ring.size()] = latency;
+        tel_samples[cls]++;
+    }
+
+    if(col_out.isOpen()) {
+        col_out.put(0, pkt->getArrivalTime().dbl());
+        col_out.put(1, pkt->getSourceId());
+        col_out.put(2, cls);
+        col_out.put(3, pkt->getSfuId());
+        col_out.put(4, latency);
+        col_out.put(5, (pkt->getWapArrivalTime() - pkt->getGenerationTime()).dbl());
+        col_out.put(6, (pkt->getWapDepartureTime() - pkt->getWapArrivalTime()).dbl());
+        col_out.put(7, (pkt->getSfuArrivalTime() - pkt->getWapDepartureTime()).dbl());
+        col_out.put(8, (pkt->getSfuDepartureTime() - pkt->getSfuArrivalTime()).dbl());
+        col_out.put(9, (pkt->getOnuArrivalTime() - pkt->getSfuDepartureTime()).dbl());
+        col_out.put(10, (pkt->getOnuDepartureTime() - pkt->getOnuArrivalTime()).dbl());
+        col_out.put(11, (pkt->getArrivalTime() - pkt->getOnuDepartureTime()).dbl());
+        col_out.endRow();
+    }
+    observeLatency(cls, latency);               // last, it ends the run once the estimates have converged
+}
+
+void OLT::checkWarmup()
+{
+    double truncation = 0;
+    for(auto &m : mser_series) {
+        if(!m.isDone())
+            return;
+        truncation = std::max(truncation, m.getTruncationTime());
+    }
+    steady = true;
+    warmup_period = truncation;
+    warmup_detected_at = simTime();
+    EV << "[olt] steady state from t = " << warmup_period << ", detected at " << simTime() << ", latency statistics start now" << endl;
+}
+
+void OLT::takeSnapshot()
+{
+    Snapshot snap;
+    snap.put("onu_rtt", onu_rtt);
+    snap.put("onu_buffer_TC2", onu_buffer_TC2);
+    snap.put("onu_buffer_TC3", onu_buffer_TC3);
+    snap.put("onu_grant_TC2", onu_grant_TC2);
+    snap.put("onu_grant_TC3", onu_grant_TC3);
+    snap.put("seqID", seqID);
+    snap.put("wavelengths", wavelengths);
+    snap.put("onu_wavelength", vector<double>(onu_wavelength.begin(), onu_wavelength.end()));
+    snap.put("onu_tuning", vector<double>(onu_tuning.begin(), onu_tuning.end()));
+    snap.put("onu_load", onu_load);
+    snap.save(Snapshot::fileName(par("snapshotDir").stringValue(), this));
+    EV << "[olt] snapshot taken at " << simTime() << endl;
+}
 
+bool OLT::restoreSnapshot()
+{
+    Snapshot snap;
+    if(!snap.load(Snapshot::fileName(par("snapshotDir").stringValue(), this))) {
+        EV << "[olt] no snapshot found, ranging from scratch" << endl;
+        return false;
+    }
+    vector<double> rtt = snap.getVector("onu_rtt");
+    if((int)rtt.size() != onus)
+        throw cRuntimeError("snapshot of %s was taken with %d onus, not %d", getFullPath().c_str(), (int)rtt.size(), onus);
+    onu_rtt = rtt;
+    onu_buffer_TC2 = snap.getVector("onu_buffer_TC2");
+    onu_buffer_TC3 = snap.getVector("onu_buffer_TC3");
+    onu_grant_TC2 = snap.getVector("onu_grant_TC2");
+    onu_grant_TC3 = snap.getVector("onu_grant_TC3");
+    seqID = snap.get("seqID");
+    if(snap.get("wavelengths", 1) == wavelengths) {       // keep the rebalanced assignment, a different wavelength count starts round robin again
+        vector<double> wl = snap.getVector("onu_wavelength");
+        vector<double> tuning = snap.getVector("onu_tuning");
+        vector<double> load = snap.getVector("onu_load");
+        if(((int)wl.size() == onus)&&((int)tuning.size() == onus)&&((int)load.size() == onus)) {
+            onu_wavelength.assign(wl.begin(), wl.end());
+            onu_tuning.assign(tuning.begin(), tuning.end());
+            onu_load = load;
+        }
+    }
+    updateMaxGrants();
+
+    cMessage *schedule_dl_gtc = new cMessage("schedule_dl_gtc");
+    scheduleAt(simTime(), schedule_dl_gtc);           // the grant scheduling continues right away
+    EV << "[olt] state restored from snapshot" << endl;
+    return true;
+}
+
+void OLT::updateMaxGrants()
+{
+    vector<int> count(wavelengths, 0);
+    for(int i = 0; i < onus; i++) {
+        count[onu_wavelength[i]]++;
+    }
+    for(int w = 0; w < wavelengths; w++) {
+        wl_max_grant[w] = (count[w] == 0) ? 0 : floor((pon.maxPollingCycle - t_guard*count[w])*(pon.extPonPayloadRate/count[w])/8);  // in Bytes
+    }
+}
+
+// moves single ONUs from the most to the least loaded wavelength as long as that narrows the gap
+// between the two, so that a few heavy XR ONUs do not share one wavelength while another idles
+void OLT::rebalanceWavelengths()
+{
+    vector<double> wl_load(wavelengths, 0);
+    for(int i = 0; i < onus; i++) {
+        wl_load[onu_wavelength[i]] += onu_load[i];
+    }
+    for(int move = 0; move < wavelengths; move++) {
+        int hi = std::max_element(wl_load.begin(), wl_load.end()) - wl_load.begin();
+        int lo = std::min_element(wl_load.begin(), wl_load.end()) - wl_load.begin();
+        double gap = wl_load[hi] - wl_load[lo];
+        if(gap <= rebalance_threshold*wl_load[hi])
+            break;
+        int best = -1;
+        double best_gap = gap;
+        for(int i = 0; i < onus; i++) {
+            if((onu_wavelength[i] == hi)&&(onu_tuning[i] == 0)&&(fabs(gap - 2*onu_load[i]) < best_gap)) {
+                best = i;
+                best_gap = fabs(gap - 2*onu_load[i]);
+            }
+        }
+        if(best < 0)
+            break;
+        EV << "[olt] onu" << best << " moves from wavelength " << hi << " to " << lo << ", loads " << wl_load[hi] << " / " << wl_load[lo] << endl;
+        onu_wavelength[best] = lo;
+        onu_tuning[best] = tuning_cycles;
+        wl_load[hi] -= onu_load[best];
+        wl_load[lo] += onu_load[best];
+        wl_moves++;
+    }
+    updateMaxGrants();
+}
+
+void OLT::traceLifecycle(ethPacket *pkt)
+{
+    static const char *data_names[] = {"xr_data", "hmd_data", "control_data", "haptic_data", "bkg_data"};     // order of ci_class_names
+    int cls = -1;
+    for(int c = 0; c < 5; c++) {
+        if(strcmp(pkt->getName(), data_names[c]) == 0)
+            cls = c;
+    }
+    if(cls < 0)                                 // fluid background bursts are volumes, not packets
+        return;
+
+    LifecycleRecord rec;
+    rec.generation = pkt->getGenerationTime().dbl();
+    rec.wapArrival = pkt->getWapArrivalTime().dbl();
+    rec.wapDeparture = pkt->getWapDepartureTime().dbl();
+    rec.sfuArrival = pkt->getSfuArrivalTime().dbl();
+    rec.sfuDeparture = pkt->getSfuDepartureTime().dbl();
+    rec.onuArrival = pkt->getOnuArrivalTime().dbl();
+    rec.onuDeparture = pkt->getOnuDepartureTime().dbl();
+    rec.oltArrival = pkt->getArrivalTime().dbl();
+    rec.sourceId = pkt->getSourceId();
+    rec.onuId = pkt->getOnuId();
+    rec.sfuId = pkt->getSfuId();
+    rec.mfuId = pkt->getMfuId();
+    rec.bytes = pkt->getByteLength();
+    rec.cls = cls;
+    rec.tcont = pkt->getTContId();
+    rec.fragmentCount = pkt->getFragmentCount();
+    lifecycle.write(rec);
+}
+
+void OLT::collectHops(int cls, ethPacket *pkt)
+{
+    // the hops add up to the end-to-end latency: wireless covers the device queue, the WiFi link, the WAP and the drop to the SFU
+    double hop[6];
+    hop[0] = (pkt->getSfuArrivalTime() - pkt->getGenerationTime()).dbl();
+    hop[1] = (pkt->getSfuDepartureTime() - pkt->getSfuArrivalTime()).dbl();     // SFU queueing until its grant
+    hop[2] = (pkt->getMfuArrivalTime() - pkt->getSfuDepartureTime()).dbl();     // 10G-PON upstream
+    hop[3] = (pkt->getOnuArrivalTime() - pkt->getMfuArrivalTime()).dbl();
+    hop[4] = (pkt->getOnuDepartureTime() - pkt->getOnuArrivalTime()).dbl();     // ONU queueing until its grant
+    hop[5] = (pkt->getArrivalTime() - pkt->getOnuDepartureTime()).dbl();        // 50G-PON upstream
+    for(int k = 0; k < 6; k++) {
+        hop_hist[cls*hop_names.size() + k]->collect(hop[k]);
+    }
+}
+
+void OLT::publishTelemetry()
+{
+    double *d = telemetry->begin(-1);
+    d[0] = simTime().dbl();
+    d[1] = getSimulation()->getEventNumber();
+    d[2] = dl_queue_size;
+    for(int c = 0; c < Telemetry::num_classes; c++) {
+        vector<double> recent = tel_latency[c];
+        double p50 = 0, p99 = 0;
+        if(!recent.empty()) {
+            size_t k = recent.size()/2;
+            std::nth_element(recent.begin(), recent.begin()+k, recent.end());
+            p50 = recent[k];
+            k = std::min(recent.size()-1, (size_t)(0.99*recent.size()));
+            std::nth_element(recent.begin(), recent.begin()+k, recent.end());
+            p99 = recent[k];
+        }
+        d[3+3*c+0] = p50;
+        d[3+3*c+1] = p99;
+        d[3+3*c+2] = tel_samples[c];
+    }
+    double *e = d + 3 + 3*Telemetry::num_classes;
+    for(int i = 0; i < onus; i++) {
+        e[Telemetry::fields*i+0] = onu_buffer_TC2[i];
+        e[Telemetry::fields*i+1] = onu_buffer_TC3[i];
+        e[Telemetry::fields*i+2] = onu_grant_TC2[i];
+        e[Telemetry::fields*i+3] = onu_grant_TC3[i];
+    }
+    telemetry->end(-1);
+}
@@ -12,9 +12,13 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
+#include "occupancy_sampler.h"
+#include "snapshot.h"
+#include "class_scheduler.h"
 
 using namespace std;
 using namespace omnetpp;
@@ -22,8 +26,10 @@ using namespace omnetpp;
 class ONU : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        PonParams pon;                          // PON dimensioning of this run
         cQueue queue_TC1;                       // queue for T-CONT 1 traffic: fixed bandwidth with guarantee
-        cQueue queue_TC2;                       // queue for T-CONT 2 traffic: assured bandwidth with bound
+        ClassScheduler queue_TC2;               // queue for T-CONT 2 traffic: assured bandwidth with bound, one sub-queue per class
         cQueue queue_TC3;                       // queue for T-CONT 3 traffic: assured bandwidth without guarantee
         cQueue gtc_dl_queue;                    // queue to store gtc_dl_headers
         double capacity;                        // buffer size = 100 MB
@@ -32,6 +38,7 @@ class ONU : public cSimpleModule
         double pending_buffer_TC3 = 0;
         double packet_drop_count = 0;
         double olt_onu_rtt = 0;
+        double olt_onu_eqd = 0;                  // equalisation delay, Teqd - RTT between a grant and the burst it starts
         double start_time_TC1 = 0;
         double onu_grant_TC1 = 0;
         double start_time_TC2 = 0;
@@ -40,6 +47,8 @@ class ONU : public cSimpleModule
         double onu_grant_TC3 = 0;
         double gtc_hdr_sz = 0;
         long seqID;
+        OccupancySampler occ_TC2;               // bucketed TC2 buffer occupancy over time
+        OccupancySampler occ_TC3;
 
         //simsignal_t latencySignalXr;
         //simsignal_t latencySignalBkg;
@@ -51,23 +60,42 @@ class ONU : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
+        virtual void takeSnapshot();
+        virtual void restoreSnapshot();
 };
 
 Define_Module(ONU);
 
 void ONU::initialize()
 {
+    pon.read(getParentModule());
+    check_and_cast<cDatarateChannel *>(gate("SpltGate_o")->getChannel())->setDatarate(pon.extPonPayloadRate);   // upstream fibre, FEC parity excluded
     //latencySignalXr = registerSignal("xr_latency");  // registering the signal
     //latencySignalBkg = registerSignal("bkg_latency");
 
     queue_TC1.setName("queue_TC1");
-    queue_TC2.setName("queue_TC2");
+    queue_TC2.init("queue_TC2", par("tc2Scheduler").stringValue(), par("tc2Weights").stringValue(), par("tc2Quantum").doubleValue());
     queue_TC3.setName("queue_TC3");
     gtc_dl_queue.setName("gtc_dl_queue");
-    capacity = onu_buffer_capacity;
+
+    double occ_bucket = par("occupancyBucket");
+    int occ_points = par("occupancyMaxPoints");
+    occ_TC2.init("TC2 buffer occupancy", occ_bucket, occ_points);
+    occ_TC3.init("TC3 buffer occupancy", occ_bucket, occ_points);
+
+    double snapshot_at = par("snapshotAt");
+    if(snapshot_at >= 0) {
+        scheduleAt(snapshot_at, new cMessage("take_snapshot"));
+    }
+    capacity = pon.onuBufferCapacity;
 
     gate("inMFU")->setDeliverImmediately(true);
     gate("SpltGate_i")->setDeliverImmediately(true);
+
+    if(par("restoreSnapshot").boolValue()) {
+        restoreSnapshot();
+    }
 }
 
 ONU::~ONU()
@@ -89,17 +117,21 @@ ONU::~ONU()
 
 void ONU::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(queue_TC1.getLength()+queue_TC2.getLength()+queue_TC3.getLength());
     if(msg->isPacket() == true) {
-        if(strcmp(msg->getName(),"bkg_data") == 0) {                    // background traffic is considered for T-CONT 3
+        if((strcmp(msg->getName(),"bkg_data") == 0)||(strcmp(msg->getName(),"bkg_fluid") == 0)) {         // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= onu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.onuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setOnuArrivalTime(simTime());
                 pkt->setOnuId(getIndex());
                 pkt->setTContId(3);             // for TC-3
                 //EV << "[onu" << getIndex() << "] Packet arrived from source and being queued at ONU" << endl;
                 queue_TC3.insert(pkt);
                 pending_buffer_TC3 += pkt->getByteLength();
+                occ_TC3.update(simTime(), pending_buffer_TC3);
 
                 //EV << "[onu" << getIndex() << "] Current TC3 queue length = " << queue_TC3.getLength() << " at ONU = " << getIndex() <<endl;
                 //EV << "[onu" << getIndex() << "] Current buffer length = " << pending_buffer_TC3 << " at ONU = " << getIndex() <<endl;
@@ -109,7 +141,7 @@ void ONU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"xr_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= onu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.onuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setOnuArrivalTime(simTime());
                 pkt->setOnuId(getIndex());
                 pkt->setTContId(2);             // for TC-2
@@ -118,6 +150,7 @@ void ONU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[onu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at ONU = " << getIndex() <<endl;
@@ -128,7 +161,7 @@ void ONU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"hmd_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= onu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.onuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setOnuArrivalTime(simTime());
                 pkt->setOnuId(getIndex());
                 pkt->setTContId(2);             // for TC-2
@@ -137,6 +170,7 @@ void ONU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[onu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at ONU = " << getIndex() <<endl;
@@ -147,7 +181,7 @@ void ONU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"control_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= onu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.onuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setOnuArrivalTime(simTime());
                 pkt->setOnuId(getIndex());
                 pkt->setTContId(2);             // for TC-2
@@ -156,6 +190,7 @@ void ONU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[onu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at ONU = " << getIndex() <<endl;
@@ -166,7 +201,7 @@ void ONU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"haptic_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= onu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.onuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setOnuArrivalTime(simTime());
                 pkt->setOnuId(getIndex());
                 pkt->setTContId(2);             // for TC-2
@@ -175,6 +210,7 @@ void ONU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[onu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at ONU = " << getIndex() <<endl;
@@ -187,12 +223,14 @@ void ONU::handleMessage(cMessage *msg)
             simtime_t arr_time = pkt->getArrivalTime();
             EV << "[onu" << getIndex() << "] gtc_hdr_dl arrival time: " << arr_time << endl;
 
-            olt_onu_rtt = pkt->getOlt_onu_rtt(getIndex());
-            start_time_TC2 = pkt->getOnu_start_time_TC2(getIndex());
+            int index = (pkt->getOlt_onu_rttArraySize() == 1) ? 0 : getIndex();     // the splitter forwards only our own entry
+            olt_onu_rtt = pkt->getOlt_onu_rtt(index);
+            start_time_TC2 = pkt->getOnu_start_time_TC2(index);
 
             EV << "[onu" << getIndex() << "] olt_onu_rtt: " << olt_onu_rtt << ", start_time_TC2: " << start_time_TC2 << endl;
 
-            simtime_t ul_tx_time = arr_time + (simtime_t)(2*max_polling_cycle + start_time_TC2 - olt_onu_rtt);      // if RTT > 125/2 usec, then multiply by 2, else 1
+            olt_onu_eqd = pkt->getTeqd() - olt_onu_rtt;
+            simtime_t ul_tx_time = arr_time + (simtime_t)(olt_onu_eqd + start_time_TC2);      // every burst reaches the head end Teqd + start time after the grant left it
             // - (pkt->getBitLength()/pon_link_datarate)
             cMessage *send_ul_header = new cMessage("send_ul_header");    // send uplink data
             scheduleAt(ul_tx_time, send_ul_header);
@@ -201,6 +239,9 @@ void ONU::handleMessage(cMessage *msg)
             //delete pkt;
             gtc_dl_queue.insert(pkt);
         }
+        else if((strcmp(msg->getName(),"xr_dl_data") == 0)||(strcmp(msg->getName(),"hmd_dl_data") == 0)||(strcmp(msg->getName(),"bkg_dl_data") == 0)) {
+            send(msg,"outMFU");                       // downstream payload is handed over to the MFU
+        }
     }
     else {      // if not packet but a message
         if(strcmp(msg->getName(),"ping") == 0) {
@@ -209,14 +250,19 @@ void ONU::handleMessage(cMessage *msg)
             send(png,"SpltGate_o");                   // immediately send the ping message back
             //EV << "[onu" << getIndex() << "] Sending ping response from ONU-" << getIndex() << endl;
         }
+        else if(strcmp(msg->getName(),"take_snapshot") == 0) {
+            delete msg;
+            takeSnapshot();
+        }
         else if(strcmp(msg->getName(),"send_ul_header") == 0) {
             cancelAndDelete(msg);         // delete the current instance of self-message
 
             gtc_hdr_sz = 3 + 1 + 1 + 5 + 8;                   // total size of GTC UL header: Preamble+Delim+BIP+PLOu_Header
             if(!gtc_dl_queue.isEmpty()) {
                 gtc_header *dl_hdr = (gtc_header *)gtc_dl_queue.pop();
-                onu_grant_TC2 = std::max(0.0,dl_hdr->getOnu_grant_TC2(getIndex()));
-                onu_grant_TC3 = std::max(0.0,dl_hdr->getOnu_grant_TC3(getIndex()) - gtc_hdr_sz);
+                int index = (dl_hdr->getOnu_grant_TC2ArraySize() == 1) ? 0 : getIndex();
+                onu_grant_TC2 = std::max(0.0,dl_hdr->getOnu_grant_TC2(index));
+                onu_grant_TC3 = std::max(0.0,dl_hdr->getOnu_grant_TC3(index) - gtc_hdr_sz);
                 seqID = dl_hdr->getSeqID();
                 delete dl_hdr;          // deleting the used gtc_dl_header
             }
@@ -235,7 +281,7 @@ void ONU::handleMessage(cMessage *msg)
             EV << "[onu" << getIndex() << "] Sending gtc_hdr_ul from ONU-" << getIndex() << " at = " << simTime() << " for seqID = " << seqID << endl;
             send(gtc_hdr_ul,"SpltGate_o");
 
-            simtime_t Txtime = (simtime_t)(gtc_hdr_ul->getBitLength()/ext_pon_link_datarate);
+            simtime_t Txtime = (simtime_t)(gtc_hdr_ul->getBitLength()/pon.extPonPayloadRate);
 
             cMessage *send_ul_payload = new cMessage("send_ul_payload_TC2");            // send uplink data
             scheduleAt(gtc_hdr_ul->getSendingTime()+Txtime, send_ul_payload);
@@ -252,6 +298,7 @@ void ONU::handleMessage(cMessage *msg)
                         ethPacket *data = (ethPacket *)queue_TC2.pop();          // pop and send the packet
                         onu_grant_TC2 = std::max(0.0,onu_grant_TC2-data->getByteLength());
                         pending_buffer_TC2 = std::max(0.0,pending_buffer_TC2-data->getByteLength());
+                        occ_TC2.update(simTime(), pending_buffer_TC2);
 
                         EV << "[onu" << getIndex() << "] at " << simTime() << " Sending ul payload: " << data->getByteLength() << ", pending_buffer_TC2 = " << pending_buffer_TC2 << ", onu_grant_TC2 = " << onu_grant_TC2 << endl;
                         send(data,"SpltGate_o");
@@ -262,7 +309,7 @@ void ONU::handleMessage(cMessage *msg)
                         //emit(latencySignalXr, xr_packet_latency);
 
                         // rescheduling send_ul_payload to send the consecutive queued packets
-                        simtime_t Txtime = (simtime_t)(data->getBitLength()/ext_pon_link_datarate);
+                        simtime_t Txtime = (simtime_t)(data->getBitLength()/pon.extPonPayloadRate);
                         scheduleAt(data->getSendingTime()+Txtime,msg);
                         //EV << "[onu" << getIndex() << "] send_ul_payload re-scheduled!" << endl;
                     }
@@ -275,21 +322,18 @@ void ONU::handleMessage(cMessage *msg)
                             copy->setByteLength(onu_grant_TC2);
                             int fragment_count = data->getFragmentCount()+1;
                             copy->setFragmentCount(fragment_count);
+                            copy->setMoreFragments(true);                             // the remainder stays queued and ends the packet
                             data->setFragmentCount(fragment_count);
 
                             send(copy,"SpltGate_o");
                             copy->setOnuDepartureTime(copy->getSendingTime());
 
                             data->setByteLength(pkt_size - onu_grant_TC2);
-                            if(!queue_TC2.isEmpty()) {
-                                queue_TC2.insertBefore(queue_TC2.front(), data);
-                            }
-                            else {
-                                queue_TC2.insert(data);
-                            }
+                            queue_TC2.pushFront(data);                                // the remainder is sent first when its class is served again
                             //EV << "[onu" << getIndex() << "] at " << simTime() << " sent fragmented packet of size: " << onu_grant_TC2 << " and en-queued packet of size = " << data->getByteLength() << endl;
 
                             pending_buffer_TC2 = std::max(0.0,pending_buffer_TC2 - onu_grant_TC2);
+                            occ_TC2.update(simTime(), pending_buffer_TC2);
                             onu_grant_TC2 = 0;          // grant exhausted!
 
                             //double xr_packet_latency = copy->getOnuDepartureTime().dbl() - copy->getOnuArrivalTime().dbl();
@@ -297,7 +341,7 @@ void ONU::handleMessage(cMessage *msg)
                             //emit(latencySignalXr, xr_packet_latency);
 
                             //delete msg;   // cleaning up packetSend msg
-                            simtime_t Txtime = (simtime_t)(copy->getBitLength()/ext_pon_link_datarate);
+                            simtime_t Txtime = (simtime_t)(copy->getBitLength()/pon.extPonPayloadRate);
                             scheduleAt(copy->getSendingTime()+Txtime,msg);
                             EV << "[onu" << getIndex() << "] 246 ul TC2 transmission finished at: " << simTime() << " for seqID = " << seqID << endl;
                         }
@@ -327,6 +371,7 @@ void ONU::handleMessage(cMessage *msg)
                         ethPacket *data = (ethPacket *)queue_TC3.pop();          // pop and send the packet
                         onu_grant_TC3 = std::max(0.0,onu_grant_TC3-data->getByteLength());
                         pending_buffer_TC3 = std::max(0.0,pending_buffer_TC3-data->getByteLength());
+                        occ_TC3.update(simTime(), pending_buffer_TC3);
 
                         EV << "[onu" << getIndex() << "] at " << simTime() << " Sending ul payload: " << data->getByteLength() << ", pending_buffer_TC3 = " << pending_buffer_TC3 << ", onu_grant_TC3 = " << onu_grant_TC3 << endl;
                         send(data,"SpltGate_o");
@@ -345,7 +390,7 @@ void ONU::handleMessage(cMessage *msg)
 
                         // rescheduling send_ul_payload to send the consecutive queued packets
                         if(pending_buffer_TC3 > 0) {
-                            simtime_t Txtime = (simtime_t)(data->getBitLength()/ext_pon_link_datarate);
+                            simtime_t Txtime = (simtime_t)(data->getBitLength()/pon.extPonPayloadRate);
                             scheduleAt(data->getSendingTime()+Txtime,msg);
                             //EV << "[onu" << getIndex() << "] send_ul_payload re-scheduled!" << endl;
                         }
@@ -363,6 +408,7 @@ void ONU::handleMessage(cMessage *msg)
                             copy->setByteLength(onu_grant_TC3);
                             int fragment_count = data->getFragmentCount()+1;
                             copy->setFragmentCount(fragment_count);
+                            copy->setMoreFragments(true);                             // the remainder stays queued and ends the packet
                             data->setFragmentCount(fragment_count);
 
                             send(copy,"SpltGate_o");
@@ -378,6 +424,7 @@ void ONU::handleMessage(cMessage *msg)
                             //EV << "[onu" << getIndex() << "] at " << simTime() << " sent fragmented packet of size: " << onu_grant_TC3 << " and en-queued packet of size = " << data->getByteLength() << endl;
 
                             pending_buffer_TC3 = std::max(0.0,pending_buffer_TC3 - onu_grant_TC3);
+                            occ_TC3.update(simTime(), pending_buffer_TC3);
                             onu_grant_TC3 = 0;          // grant exhausted!
 
                             /*if(strcmp(data->getName(),"bkg_data") == 0) {
@@ -413,4 +460,42 @@ void ONU::handleMessage(cMessage *msg)
     }
 }
 
+void ONU::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+    recordScalar("rtt", olt_onu_rtt, "s");
+    recordScalar("equalisationDelay", olt_onu_eqd, "s");
+    occ_TC2.record(simTime());
+    occ_TC3.record(simTime());
+    if(!queue_TC2.isFifo()) {
+        for(int c = 0; c < ClassScheduler::num_classes; c++) {
+            string cls = ClassScheduler::class_names[c];
+            recordScalar((cls + " TC2 packets sent").c_str(), queue_TC2.sentPackets[c]);
+            recordScalar((cls + " TC2 bytes sent").c_str(), queue_TC2.sentBytes[c]);
+        }
+    }
+}
+
+void ONU::takeSnapshot()
+{
+    Snapshot snap;
+    queue_TC2.put(snap, "queue_TC2");
+    snap.putQueue("queue_TC3", queue_TC3);
+    snap.save(Snapshot::fileName(par("snapshotDir").stringValue(), this));
+    EV << "[onu" << getIndex() << "] snapshot taken at " << simTime() << endl;
+}
 
+void ONU::restoreSnapshot()
+{
+    Snapshot snap;
+    if(!snap.load(Snapshot::fileName(par("snapshotDir").stringValue(), this))) {
+        EV << "[onu" << getIndex() << "] no snapshot found, starting with empty queues" << endl;
+        return;
+    }
+    pending_buffer_TC2 = queue_TC2.restore(snap, "queue_TC2");
+    pending_buffer_TC3 = snap.restoreQueue("queue_TC3", queue_TC3);
+    occ_TC2.update(simTime(), pending_buffer_TC2);
+    occ_TC3.update(simTime(), pending_buffer_TC3);
+    EV << "[onu" << getIndex() << "] restored " << queue_TC2.getLength() + queue_TC3.getLength() << " queued packets from snapshot" << endl;
+}
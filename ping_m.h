@@ -24,6 +24,7 @@ class ping;
  * {
  *     int ONU_id;
  *     int SFU_id;
+ *     simtime_t SendTime;					// set by the OLT/MFU, RTT = arrival of the response - SendTime
  * }
  * </pre>
  */
@@ -32,6 +33,7 @@ class ping : public ::omnetpp::cMessage
   protected:
     int ONU_id = 0;
     int SFU_id = 0;
+    omnetpp::simtime_t SendTime = SIMTIME_ZERO;
 
   private:
     void copy(const ping& other);
@@ -53,6 +55,9 @@ class ping : public ::omnetpp::cMessage
 
     virtual int getSFU_id() const;
     virtual void setSFU_id(int SFU_id);
+
+    virtual omnetpp::simtime_t getSendTime() const;
+    virtual void setSendTime(omnetpp::simtime_t SendTime);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const ping& obj) {obj.parsimPack(b);}
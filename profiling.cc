@@ -0,0 +1,73 @@
+/*
+ * profiling.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include "profiling.h"
+
+#ifdef FTTR_PROFILING
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace omnetpp;
+
+typedef map<pair<string,string>, ProfileEntry> ProfileTable;
+static ProfileTable profile_table;                              // (module type, message name) -> counters
+
+struct PointerPairHash
+{
+    size_t operator()(const pair<const char *, const char *> &k) const { return hash<const void *>()(k.first)*31 + hash<const void *>()(k.second); }
+};
+
+// the class name and the (pooled) message name are mostly the same pointers from event to event, so the
+// entry is found by pointer without building strings; the names are compared in case a pointer was reused
+static unordered_map<pair<const char *, const char *>, ProfileTable::value_type *, PointerPairHash> profile_cache;
+
+ProfileEntry &Profiler::entry(const char *moduleType, const char *msgName)
+{
+    auto key = make_pair(moduleType, msgName);
+    auto it = profile_cache.find(key);
+    if(it != profile_cache.end() && strcmp(it->second->first.first.c_str(), moduleType) == 0
+            && strcmp(it->second->first.second.c_str(), msgName) == 0)
+        return it->second->second;
+    ProfileTable::value_type &row = *profile_table.emplace(make_pair(string(moduleType), string(msgName)), ProfileEntry()).first;
+    profile_cache[key] = &row;
+    return row.second;
+}
+
+void Profiler::dump()
+{
+    if(profile_table.empty())           // every module calls this from finish(), the first one prints and clears the table
+        return;
+
+    vector<pair<pair<string,string>, ProfileEntry>> rows(profile_table.begin(), profile_table.end());
+    sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.second.totalNs > b.second.totalNs; });
+    double total = 0;
+    for(auto &r : rows)
+        total += r.second.totalNs;
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-20s %-20s %12s %10s %7s %10s %10s %9s %9s", "module", "message", "events", "total[ms]", "share",
+             "mean[ns]", "max[ns]", "obj/evt", "queue");
+    EV_INFO << "handler profile:" << endl << line << endl;
+    for(auto &r : rows) {
+        const ProfileEntry &e = r.second;
+        snprintf(line, sizeof(line), "%-20s %-20s %12ld %10.1f %6.1f%% %10.0f %10.0f %9.2f %5.1f/%ld", r.first.first.c_str(),
+                 r.first.second.c_str(), e.events, e.totalNs*1e-6, total > 0 ? 100*e.totalNs/total : 0,
+                 e.totalNs/e.events, e.maxNs, (double)e.objects/e.events, e.queueSum/e.events, e.queueMax);
+        EV_INFO << line << endl;
+    }
+    profile_table.clear();
+    profile_cache.clear();
+}
+
+#endif /* FTTR_PROFILING */
@@ -0,0 +1,82 @@
+/*
+ * profiling.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef PROFILING_H_
+#define PROFILING_H_
+
+/*
+ * Hot-path profiling of the message handlers, compiled in only with -DFTTR_PROFILING.
+ * FTTR_PROFILE_HANDLER(msg) at the top of handleMessage() times the handler with steady_clock and
+ * counts the objects it allocates, per module type and message name. FTTR_PROFILE_QUEUE(len) adds
+ * the module's queue length at the start of the event. The table is written to the EV_INFO log once by
+ * Profiler::dump() when the first module of a run finishes. Without the flag the macros expand to nothing.
+ */
+
+#ifdef FTTR_PROFILING
+
+#include <chrono>
+#include <string>
+#include <omnetpp.h>
+
+struct ProfileEntry
+{
+    long events = 0;
+    double totalNs = 0;                 // cumulative handler time
+    double maxNs = 0;                   // longest single handler call
+    long objects = 0;                   // cOwnedObjects created inside the handler
+    double queueSum = 0;                // queue length at event start, summed over the events
+    long queueMax = 0;
+};
+
+class Profiler
+{
+    public:
+        static ProfileEntry &entry(const char *moduleType, const char *msgName);
+        static void dump();
+};
+
+class ProfileScope
+{
+    private:
+        ProfileEntry &e;
+        std::chrono::steady_clock::time_point start;
+        long objects;
+
+    public:
+        ProfileScope(omnetpp::cSimpleModule *mod, omnetpp::cMessage *msg) :
+            e(Profiler::entry(mod->getClassName(), msg->getName())),
+            start(std::chrono::steady_clock::now()),
+            objects(omnetpp::cOwnedObject::getTotalObjectCount()) { e.events++; }
+
+        ~ProfileScope() {
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            e.totalNs += ns;
+            if(ns > e.maxNs)
+                e.maxNs = ns;
+            e.objects += omnetpp::cOwnedObject::getTotalObjectCount() - objects;
+        }
+
+        void queue(long len) {
+            e.queueSum += len;
+            if(len > e.queueMax)
+                e.queueMax = len;
+        }
+};
+
+#define FTTR_PROFILE_HANDLER(msg) ProfileScope profile_scope_(this, msg)
+#define FTTR_PROFILE_QUEUE(len) profile_scope_.queue(len)
+#define FTTR_PROFILE_DUMP() Profiler::dump()
+
+#else
+
+#define FTTR_PROFILE_HANDLER(msg)
+#define FTTR_PROFILE_QUEUE(len)
+#define FTTR_PROFILE_DUMP()
+
+#endif /* FTTR_PROFILING */
+
+#endif /* PROFILING_H_ */
@@ -0,0 +1,102 @@
+/*
+ * reassembly.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include "reassembly.h"
+
+using namespace omnetpp;
+
+void Reassembly::init(simtime_t timeout, size_t maxPending)
+{
+    this->timeout = timeout;
+    this->maxPending = std::max<size_t>(1, maxPending);
+    pending.clear();
+    order.clear();
+    dropped.clear();
+    dropped_order.clear();
+    completed = timedOut = evicted = orphans = 0;
+}
+
+void Reassembly::drop(const Key &key, simtime_t now)
+{
+    pending.erase(key);
+    dropped[key] = now;
+    dropped_order.push_back(std::make_pair(now, key));
+}
+
+void Reassembly::expire(simtime_t now)
+{
+    // entries completed in the meantime are left in order and skipped here
+    while(!order.empty()) {
+        auto it = pending.find(order.front().second);
+        if((it != pending.end())&&(it->second.firstArrival == order.front().first)) {
+            if(now - it->second.firstArrival <= timeout)
+                break;
+            timedOut++;
+            drop(it->first, now);
+        }
+        order.pop_front();
+    }
+    // a dropped packet is remembered for another timeout, long enough for its remaining fragments
+    while((!dropped_order.empty())&&(now - dropped_order.front().first > timeout)) {
+        auto it = dropped.find(dropped_order.front().second);
+        if((it != dropped.end())&&(it->second == dropped_order.front().first))
+            dropped.erase(it);
+        dropped_order.pop_front();
+    }
+}
+
+bool Reassembly::add(ethPacket *pkt)
+{
+    if(pkt->getSourceId() < 0)
+        return true;
+
+    simtime_t now = pkt->getArrivalTime();
+    expire(now);
+    Key key(pkt->getSourceId(), pkt->getSeqNo());
+
+    if(dropped.count(key) > 0) {
+        if(!pkt->getMoreFragments())
+            dropped.erase(key);                     // nothing more will arrive for this packet
+        orphans++;
+        return false;
+    }
+
+    auto it = pending.find(key);
+    if(pkt->getMoreFragments()) {
+        if(it == pending.end()) {
+            if(pending.size() >= maxPending) {      // the front of order is the oldest open packet after expire()
+                evicted++;
+                drop(order.front().second, now);
+                order.pop_front();
+            }
+            it = pending.emplace(key, Pending()).first;
+            it->second.firstArrival = now;
+            order.push_back(std::make_pair(now, key));
+        }
+        it->second.bytes += pkt->getByteLength();
+        it->second.fragments++;
+        return false;
+    }
+
+    if(it == pending.end())
+        return true;                                // never fragmented
+    pkt->setByteLength(it->second.bytes + pkt->getByteLength());
+    pending.erase(it);
+    completed++;
+    return true;
+}
+
+void Reassembly::discard(ethPacket *pkt)
+{
+    if(pkt->getSourceId() < 0)
+        return;
+    Key key(pkt->getSourceId(), pkt->getSeqNo());
+    if(pkt->getMoreFragments())
+        drop(key, pkt->getArrivalTime());       // the remaining fragments become orphans
+    else
+        pending.erase(key);
+}
@@ -0,0 +1,63 @@
+/*
+ * reassembly.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef REASSEMBLY_H_
+#define REASSEMBLY_H_
+
+#include <stddef.h>
+#include <deque>
+#include <map>
+#include <utility>
+#include <omnetpp.h>
+
+#include "ethPacket_m.h"
+
+/*
+ * Reassembly of the fragments an SFU or ONU cuts when a grant ends inside a packet. A fragment
+ * carries the (SourceId, SeqNo) of its packet and MoreFragments on all but the last piece; the
+ * pieces of one packet travel the same FIFO path, so the last one also arrives last. add() absorbs
+ * every leading fragment and turns the last one into the whole packet: its byte length becomes
+ * the sum of all pieces and its timestamps are those of the last piece, so the latency is measured
+ * when the packet is complete. The state is bounded: a packet whose last fragment has not arrived
+ * within the timeout is dropped, and the oldest packet is evicted when maxPending are open; fragments
+ * of a dropped packet that still arrive are discarded as orphans.
+ * Packets without a SourceId (restored from a snapshot) are passed through untouched.
+ */
+class Reassembly
+{
+    private:
+        struct Pending
+        {
+            omnetpp::simtime_t firstArrival;
+            double bytes = 0;
+            int fragments = 0;
+        };
+        typedef std::pair<int, long> Key;       // (SourceId, SeqNo)
+
+        omnetpp::simtime_t timeout = 0.01;
+        size_t maxPending = 65536;
+        std::map<Key, Pending> pending;
+        std::deque<std::pair<omnetpp::simtime_t, Key>> order;      // open packets by first arrival, for expiry
+        std::map<Key, omnetpp::simtime_t> dropped;                  // recently dropped packets, their later fragments are orphans
+        std::deque<std::pair<omnetpp::simtime_t, Key>> dropped_order;
+
+        void drop(const Key &key, omnetpp::simtime_t now);
+        void expire(omnetpp::simtime_t now);
+
+    public:
+        long completed = 0;                     // packets rebuilt from more than one fragment
+        long timedOut = 0;                      // incomplete packets dropped after the timeout
+        long evicted = 0;                       // incomplete packets dropped because maxPending were open
+        long orphans = 0;                       // fragments arriving after their packet had been dropped
+
+        void init(omnetpp::simtime_t timeout, size_t maxPending);
+        bool add(ethPacket *pkt);               // false: the fragment was absorbed or belongs to a dropped packet, the caller deletes it
+        void discard(ethPacket *pkt);           // pkt was lost on the link, the rest of its packet is dropped
+        size_t getPending() const { return pending.size(); }
+};
+
+#endif /* REASSEMBLY_H_ */
@@ -12,9 +12,13 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
+#include "occupancy_sampler.h"
+#include "snapshot.h"
+#include "class_scheduler.h"
 
 using namespace std;
 using namespace omnetpp;
@@ -22,8 +26,10 @@ using namespace omnetpp;
 class SFU : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        PonParams pon;                          // PON dimensioning of this run
         cQueue queue_TC1;                       // queue for T-CONT 1 traffic: fixed bandwidth with guarantee
-        cQueue queue_TC2;                       // queue for T-CONT 2 traffic: assured bandwidth with bound
+        ClassScheduler queue_TC2;               // queue for T-CONT 2 traffic: assured bandwidth with bound, one sub-queue per class
         cQueue queue_TC3;                       // queue for T-CONT 3 traffic: assured bandwidth without guarantee
         cQueue gtc_dl_queue;                    // queue to store gtc_dl_headers
         double capacity;                        // buffer size = 100 MB
@@ -32,6 +38,7 @@ class SFU : public cSimpleModule
         double pending_buffer_TC3 = 0;
         double packet_drop_count = 0;
         double mfu_sfu_rtt = 0;
+        double mfu_sfu_eqd = 0;                  // equalisation delay, Teqd - RTT between a grant and the burst it starts
         double start_time_TC1 = 0;
         double sfu_grant_TC1 = 0;
         double start_time_TC2 = 0;
@@ -40,6 +47,14 @@ class SFU : public cSimpleModule
         double sfu_grant_TC3 = 0;
         double gtc_hdr_sz = 0;
         long seqID;
+        OccupancySampler occ_TC2;               // bucketed TC2 buffer occupancy over time
+        OccupancySampler occ_TC3;
+        bool fluidBackground;                   // background devices replaced by a fluid TC3 arrival rate
+        double fluid_rate = 0;                  // fluid background arrival rate (Bytes/s)
+        double fluid_backlog = 0;               // fluid bytes not yet turned into bkg_fluid bursts
+        long fluid_seq = 0;                     // SeqNo of the next burst, the SFU is the source of its bursts
+        double fluid_dropped = 0;               // fluid bytes lost to a full buffer
+        simtime_t fluid_last = 0;               // time up to which the fluid arrivals are accounted
 
         //simsignal_t latencySignalXr;
         //simsignal_t latencySignalBkg;
@@ -51,23 +66,49 @@ class SFU : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
+        virtual void takeSnapshot();
+        virtual void restoreSnapshot();
+        virtual void accrueFluid();
 };
 
 Define_Module(SFU);
 
 void SFU::initialize()
 {
+    pon.read(getParentModule());
+    check_and_cast<cDatarateChannel *>(gate("SpltGate_out")->getChannel())->setDatarate(pon.intPonPayloadRate);   // upstream fibre, FEC parity excluded
     //latencySignalXr = registerSignal("xr_latency");                     // registering the signal
     //latencySignalBkg = registerSignal("bkg_latency");
 
     queue_TC1.setName("queue_TC1");
-    queue_TC2.setName("queue_TC2");
+    queue_TC2.init("queue_TC2", par("tc2Scheduler").stringValue(), par("tc2Weights").stringValue(), par("tc2Quantum").doubleValue());
     queue_TC3.setName("queue_TC3");
     gtc_dl_queue.setName("gtc_dl_queue");
-    capacity = sfu_buffer_capacity;
+
+    double occ_bucket = par("occupancyBucket");
+    int occ_points = par("occupancyMaxPoints");
+    occ_TC2.init("TC2 buffer occupancy", occ_bucket, occ_points);
+    occ_TC3.init("TC3 buffer occupancy", occ_bucket, occ_points);
+
+    double snapshot_at = par("snapshotAt");
+    if(snapshot_at >= 0) {
+        scheduleAt(snapshot_at, new cMessage("take_snapshot"));
+    }
+
+    fluidBackground = par("fluidBackground");
+    if(fluidBackground) {
+        // the three background devices behind the WiFi AP, each at bkgLoad of bkgDataRate
+        fluid_rate = 3*(double)par("bkgLoad")*(double)par("bkgDataRate")/8;
+    }
+    capacity = pon.sfuBufferCapacity;
 
     gate("inWap")->setDeliverImmediately(true);
     gate("SpltGate_in")->setDeliverImmediately(true);
+
+    if(par("restoreSnapshot").boolValue()) {
+        restoreSnapshot();
+    }
 }
 
 SFU::~SFU()
@@ -89,17 +130,21 @@ SFU::~SFU()
 
 void SFU::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(queue_TC1.getLength()+queue_TC2.getLength()+queue_TC3.getLength());
     if(msg->isPacket() == true) {
         if(strcmp(msg->getName(),"bkg_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= sfu_buffer_capacity) {                         // queue the current packet if there is buffer capacity
+            if(buffer <= pon.sfuBufferCapacity) {                         // queue the current packet if there is buffer capacity
                 pkt->setSfuArrivalTime(pkt->getArrivalTime());
                 pkt->setSfuId(getIndex());
                 pkt->setTContId(3);                                     // for TC-3
                 //EV << "[sfu" << getIndex() << "] Packet arrived from source and being queued at SFU" << endl;
                 queue_TC3.insert(pkt);
                 pending_buffer_TC3 += pkt->getByteLength();
+                occ_TC3.update(simTime(), pending_buffer_TC3);
 
                 //EV << "[sfu" << getIndex() << "] Current TC3 queue length = " << queue_TC3.getLength() << " at SFU = " << getIndex() <<endl;
                 //EV << "[sfu" << getIndex() << "] Current buffer length = " << pending_buffer_TC3 << " at SFU = " << getIndex() <<endl;
@@ -109,7 +154,7 @@ void SFU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"xr_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= sfu_buffer_capacity) {                             // queue the current packet if there is buffer capacity
+            if(buffer <= pon.sfuBufferCapacity) {                             // queue the current packet if there is buffer capacity
                 pkt->setSfuArrivalTime(pkt->getArrivalTime());
                 pkt->setSfuId(getIndex());
                 pkt->setTContId(2);                 // for TC-2
@@ -118,6 +163,7 @@ void SFU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[sfu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at SFU = " << getIndex() <<endl;
@@ -128,7 +174,7 @@ void SFU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"hmd_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= sfu_buffer_capacity) {                             // queue the current packet if there is buffer capacity
+            if(buffer <= pon.sfuBufferCapacity) {                             // queue the current packet if there is buffer capacity
                 pkt->setSfuArrivalTime(pkt->getArrivalTime());
                 pkt->setSfuId(getIndex());
                 pkt->setTContId(2);                 // for TC-2
@@ -137,6 +183,7 @@ void SFU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[sfu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at SFU = " << getIndex() <<endl;
@@ -147,7 +194,7 @@ void SFU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"control_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= sfu_buffer_capacity) {                             // queue the current packet if there is buffer capacity
+            if(buffer <= pon.sfuBufferCapacity) {                             // queue the current packet if there is buffer capacity
                 pkt->setSfuArrivalTime(pkt->getArrivalTime());
                 pkt->setSfuId(getIndex());
                 pkt->setTContId(2);                 // for TC-2
@@ -156,6 +203,7 @@ void SFU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[sfu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at SFU = " << getIndex() <<endl;
@@ -166,7 +214,7 @@ void SFU::handleMessage(cMessage *msg)
         else if(strcmp(msg->getName(),"haptic_data") == 0) {                    // background traffic is considered for T-CONT 3
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
             double buffer = pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3 + pkt->getByteLength();      // future buffer size if current packet is queued
-            if(buffer <= sfu_buffer_capacity) {                             // queue the current packet if there is buffer capacity
+            if(buffer <= pon.sfuBufferCapacity) {                             // queue the current packet if there is buffer capacity
                 pkt->setSfuArrivalTime(pkt->getArrivalTime());
                 pkt->setSfuId(getIndex());
                 pkt->setTContId(2);                 // for TC-2
@@ -175,6 +223,7 @@ void SFU::handleMessage(cMessage *msg)
                 queue_TC2.insert(pkt);
                 //queue_TC3.insert(pkt);
                 pending_buffer_TC2 += pkt->getByteLength();
+                occ_TC2.update(simTime(), pending_buffer_TC2);
                 //pending_buffer_TC3 += pkt->getByteLength();
 
                 //EV << "[sfu" << getIndex() << "] Current TC2 queue length = " << queue_TC2.getLength() << " at SFU = " << getIndex() <<endl;
@@ -189,14 +238,15 @@ void SFU::handleMessage(cMessage *msg)
 
             //int totalNodes = getParentModule()->getSubmodule("sfus", 0)->getVectorSize();
             int totalNodes = getParentModule()->par("NumberOfSFUs");
-            int index =  getIndex() % totalNodes;
+            int index = (pkt->getMfu_sfu_rttArraySize() == 1) ? 0 : getIndex() % totalNodes;     // the splitter forwards only our own entry
             EV << "[sfu" << getIndex() << "] totalNodes = "<< totalNodes << ", actual id: "<< index << endl;
             mfu_sfu_rtt = pkt->getMfu_sfu_rtt(index);
             start_time_TC2 = pkt->getSfu_start_time_TC2(index);
 
             EV << "[sfu" << getIndex() << "] mfu_sfu_rtt: " << mfu_sfu_rtt << ", start_time_TC2: " << start_time_TC2 << endl;
 
-            simtime_t ul_tx_time = arr_time + (simtime_t)(2*max_polling_cycle + start_time_TC2 - mfu_sfu_rtt);      // if RTT > 125/2 usec, then multiply by 2, else 1
+            mfu_sfu_eqd = pkt->getTeqd() - mfu_sfu_rtt;
+            simtime_t ul_tx_time = arr_time + (simtime_t)(mfu_sfu_eqd + start_time_TC2);      // every burst reaches the head end Teqd + start time after the grant left it
             // - (pkt->getBitLength()/pon_link_datarate)
             cMessage *send_ul_header = new cMessage("send_ul_header");    // send uplink data
             scheduleAt(ul_tx_time, send_ul_header);
@@ -205,6 +255,9 @@ void SFU::handleMessage(cMessage *msg)
             //delete pkt;
             gtc_dl_queue.insert(pkt);
         }
+        else if((strcmp(msg->getName(),"xr_dl_data") == 0)||(strcmp(msg->getName(),"hmd_dl_data") == 0)||(strcmp(msg->getName(),"bkg_dl_data") == 0)) {
+            send(msg,"outWap");                       // downstream payload is handed over to the WiFi AP
+        }
     }
     else {      // if not packet but a message
         if(strcmp(msg->getName(),"ping") == 0) {
@@ -213,6 +266,10 @@ void SFU::handleMessage(cMessage *msg)
             send(png,"SpltGate_out");                                  // immediately send the ping message back
             EV << "[sfu" << getIndex() << "] Sending ping response from SFU-" << getIndex() << " at " << simTime() << endl;
         }
+        else if(strcmp(msg->getName(),"take_snapshot") == 0) {
+            delete msg;
+            takeSnapshot();
+        }
         else if(strcmp(msg->getName(),"send_ul_header") == 0) {
             cancelAndDelete(msg);         // delete the current instance of self-message
 
@@ -220,7 +277,7 @@ void SFU::handleMessage(cMessage *msg)
             if(!gtc_dl_queue.isEmpty()) {
                 gtc_header *dl_hdr = (gtc_header *)gtc_dl_queue.pop();
                 int totalNodes = getParentModule()->par("NumberOfSFUs");
-                int index =  getIndex() % totalNodes;
+                int index = (dl_hdr->getSfu_grant_TC2ArraySize() == 1) ? 0 : getIndex() % totalNodes;
                 sfu_grant_TC2 = std::max(0.0,dl_hdr->getSfu_grant_TC2(index));
                 sfu_grant_TC3 = std::max(0.0,dl_hdr->getSfu_grant_TC3(index) - gtc_hdr_sz);
                 seqID = dl_hdr->getSeqID();
@@ -231,6 +288,7 @@ void SFU::handleMessage(cMessage *msg)
                 sfu_grant_TC3 = 0;
             }
 
+            accrueFluid();                                      // the report includes the fluid background backlog
             gtc_header *gtc_hdr_ul = new gtc_header("gtc_hdr_ul");
             gtc_hdr_ul->setByteLength(gtc_hdr_sz);
             gtc_hdr_ul->setUplink(true);
@@ -241,7 +299,7 @@ void SFU::handleMessage(cMessage *msg)
             EV << "[sfu" << getIndex() << "] Sending gtc_hdr_ul from SFU-" << getIndex() << " at = " << simTime() << " for seqID = " << seqID << endl;
             send(gtc_hdr_ul,"SpltGate_out");
 
-            simtime_t Txtime = (simtime_t)(gtc_hdr_ul->getBitLength()/int_pon_link_datarate);
+            simtime_t Txtime = (simtime_t)(gtc_hdr_ul->getBitLength()/pon.intPonPayloadRate);
 
             cMessage *send_ul_payload = new cMessage("send_ul_payload_TC2");            // send uplink data
             scheduleAt(gtc_hdr_ul->getSendingTime()+Txtime, send_ul_payload);
@@ -258,6 +316,7 @@ void SFU::handleMessage(cMessage *msg)
                         ethPacket *data = (ethPacket *)queue_TC2.pop();          // pop and send the packet
                         sfu_grant_TC2 = std::max(0.0,sfu_grant_TC2-data->getByteLength());
                         pending_buffer_TC2 = std::max(0.0,pending_buffer_TC2-data->getByteLength());
+                        occ_TC2.update(simTime(), pending_buffer_TC2);
 
                         EV << "[sfu" << getIndex() << "] at " << simTime() << " Sending ul payload: " << data->getByteLength() << ", pending_buffer_TC2 = " << pending_buffer_TC2 << ", sfu_grant_TC2 = " << sfu_grant_TC2 << endl;
                         send(data,"SpltGate_out");
@@ -268,7 +327,7 @@ void SFU::handleMessage(cMessage *msg)
                         //emit(latencySignalXr, xr_packet_latency);
 
                         // rescheduling send_ul_payload to send the consecutive queued packets
-                        simtime_t Txtime = (simtime_t)(data->getBitLength()/int_pon_link_datarate);
+                        simtime_t Txtime = (simtime_t)(data->getBitLength()/pon.intPonPayloadRate);
                         scheduleAt(data->getSendingTime()+Txtime,msg);
                         //EV << "[sfu" << getIndex() << "] send_ul_payload re-scheduled!" << endl;
                     }
@@ -281,21 +340,18 @@ void SFU::handleMessage(cMessage *msg)
                             copy->setByteLength(sfu_grant_TC2);
                             int fragment_count = data->getFragmentCount()+1;
                             copy->setFragmentCount(fragment_count);
+                            copy->setMoreFragments(true);                             // the remainder stays queued and ends the packet
                             data->setFragmentCount(fragment_count);
 
                             send(copy,"SpltGate_out");
                             copy->setSfuDepartureTime(copy->getSendingTime());
 
                             data->setByteLength(pkt_size - sfu_grant_TC2);
-                            if(!queue_TC2.isEmpty()) {
-                                queue_TC2.insertBefore(queue_TC2.front(), data);
-                            }
-                            else {
-                                queue_TC2.insert(data);
-                            }
+                            queue_TC2.pushFront(data);                                // the remainder is sent first when its class is served again
                             //EV << "[sfu" << getIndex() << "] at " << simTime() << " sent fragmented packet of size: " << onu_grant_TC2 << " and en-queued packet of size = " << data->getByteLength() << endl;
 
                             pending_buffer_TC2 = std::max(0.0,pending_buffer_TC2 - sfu_grant_TC2);
+                            occ_TC2.update(simTime(), pending_buffer_TC2);
                             sfu_grant_TC2 = 0;          // grant exhausted!
 
                             //double xr_packet_latency = copy->getSfuDepartureTime().dbl() - copy->getSfuArrivalTime().dbl();
@@ -303,7 +359,7 @@ void SFU::handleMessage(cMessage *msg)
                             //emit(latencySignalXr, xr_packet_latency);
 
                             //delete msg;   // cleaning up packetSend msg
-                            simtime_t Txtime = (simtime_t)(copy->getBitLength()/int_pon_link_datarate);
+                            simtime_t Txtime = (simtime_t)(copy->getBitLength()/pon.intPonPayloadRate);
                             scheduleAt(copy->getSendingTime()+Txtime,msg);
                             EV << "[sfu" << getIndex() << "] 246 ul TC2 transmission finished at: " << simTime() << " for seqID = " << seqID << endl;
                         }
@@ -324,6 +380,22 @@ void SFU::handleMessage(cMessage *msg)
         }
         else if(strcmp(msg->getName(),"send_ul_payload_TC3") == 0) {
             // for T-CONT 3
+            if(fluidBackground) {
+                accrueFluid();
+                if((queue_TC3.isEmpty())&&(fluid_backlog >= pkt_sz_min)&&(sfu_grant_TC3 >= pkt_sz_min)) {
+                    // the fluid backlog that fits into the grant leaves as one burst, smaller rests wait for the next grant
+                    ethPacket *burst = new ethPacket("bkg_fluid");
+                    burst->setByteLength(floor(std::min(fluid_backlog, sfu_grant_TC3)));
+                    burst->setGenerationTime(simTime() - (simtime_t)(fluid_backlog/fluid_rate));    // oldest fluid byte, FIFO at constant rate
+                    burst->setSfuArrivalTime(burst->getGenerationTime());
+                    burst->setSfuId(getIndex());
+                    burst->setSourceId(getId());
+                    burst->setSeqNo(fluid_seq++);
+                    burst->setTContId(3);
+                    fluid_backlog = std::max(0.0, fluid_backlog - burst->getByteLength());
+                    queue_TC3.insert(burst);
+                }
+            }
             EV << "[sfu" << getIndex() << "] sfu_grant_TC3: " << sfu_grant_TC3 << ", pending_buffer_TC3 = " << pending_buffer_TC3 << ", msg->isScheduled(): " << msg->isScheduled() << endl;
             if((sfu_grant_TC3 > 0)&&(pending_buffer_TC3 > 0)&&(!msg->isScheduled())) {
                 //EV << "[onu" << getIndex() << "] queue_TC3.isEmpty(): " << queue_TC3.isEmpty() << endl;
@@ -333,6 +405,7 @@ void SFU::handleMessage(cMessage *msg)
                         ethPacket *data = (ethPacket *)queue_TC3.pop();          // pop and send the packet
                         sfu_grant_TC3 = std::max(0.0,sfu_grant_TC3-data->getByteLength());
                         pending_buffer_TC3 = std::max(0.0,pending_buffer_TC3-data->getByteLength());
+                        occ_TC3.update(simTime(), pending_buffer_TC3);
 
                         EV << "[sfu" << getIndex() << "] at " << simTime() << " Sending ul payload: " << data->getByteLength() << ", pending_buffer_TC3 = " << pending_buffer_TC3 << ", sfu_grant_TC3 = " << sfu_grant_TC3 << endl;
                         send(data,"SpltGate_out");
@@ -351,7 +424,7 @@ void SFU::handleMessage(cMessage *msg)
 
                         // rescheduling send_ul_payload to send the consecutive queued packets
                         if(pending_buffer_TC3 > 0) {
-                            simtime_t Txtime = (simtime_t)(data->getBitLength()/int_pon_link_datarate);
+                            simtime_t Txtime = (simtime_t)(data->getBitLength()/pon.intPonPayloadRate);
                             scheduleAt(data->getSendingTime()+Txtime,msg);
                             //EV << "[sfu" << getIndex() << "] send_ul_payload re-scheduled!" << endl;
                         }
@@ -369,6 +442,7 @@ void SFU::handleMessage(cMessage *msg)
                             copy->setByteLength(sfu_grant_TC3);
                             int fragment_count = data->getFragmentCount()+1;
                             copy->setFragmentCount(fragment_count);
+                            copy->setMoreFragments(true);                             // the remainder stays queued and ends the packet
                             data->setFragmentCount(fragment_count);
 
                             send(copy,"SpltGate_out");
@@ -384,6 +458,7 @@ void SFU::handleMessage(cMessage *msg)
                             //EV << "[sfu" << getIndex() << "] at " << simTime() << " sent fragmented packet of size: " << sfu_grant_TC3 << " and en-queued packet of size = " << data->getByteLength() << endl;
 
                             pending_buffer_TC3 = std::max(0.0,pending_buffer_TC3 - sfu_grant_TC3);
+                            occ_TC3.update(simTime(), pending_buffer_TC3);
                             sfu_grant_TC3 = 0;          // grant exhausted!
 
                             /*if(strcmp(data->getName(),"bkg_data") == 0) {
@@ -399,7 +474,7 @@ void SFU::handleMessage(cMessage *msg)
 
                             delete msg;   // cleaning up packetSend msg
                             EV << "[sfu" << getIndex() << "] deleting msg @ 320" << endl;
-                            /*simtime_t Txtime = (simtime_t)(copy->getBitLength()/int_pon_link_datarate);
+                            /*simtime_t Txtime = (simtime_t)(copy->getBitLength()/pon.intPonPayloadRate);
                             scheduleAt(copy->getSendingTime()+Txtime,msg);*/
                             EV << "[sfu" << getIndex() << "] 322 ul TC3 transmission finished at: " << simTime() << " for seqID = " << seqID << endl;
                         }
@@ -419,7 +494,64 @@ void SFU::handleMessage(cMessage *msg)
     }
 }
 
+void SFU::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+    recordScalar("rtt", mfu_sfu_rtt, "s");
+    recordScalar("equalisationDelay", mfu_sfu_eqd, "s");
+    occ_TC2.record(simTime());
+    occ_TC3.record(simTime());
+    if(!queue_TC2.isFifo()) {
+        for(int c = 0; c < ClassScheduler::num_classes; c++) {
+            string cls = ClassScheduler::class_names[c];
+            recordScalar((cls + " TC2 packets sent").c_str(), queue_TC2.sentPackets[c]);
+            recordScalar((cls + " TC2 bytes sent").c_str(), queue_TC2.sentBytes[c]);
+        }
+    }
+    if(fluidBackground) {
+        recordScalar("fluidBytesDropped", fluid_dropped);
+    }
+}
 
+void SFU::accrueFluid()
+{
+    if(!fluidBackground)
+        return;
+    double bytes = fluid_rate*(simTime() - fluid_last).dbl();
+    fluid_last = simTime();
+    double room = pon.sfuBufferCapacity - (pending_buffer_TC1 + pending_buffer_TC2 + pending_buffer_TC3);
+    if(bytes > room) {                                  // the excess is dropped like packets at a full buffer
+        fluid_dropped += bytes - std::max(0.0, room);
+        bytes = std::max(0.0, room);
+    }
+    fluid_backlog += bytes;
+    pending_buffer_TC3 += bytes;
+    occ_TC3.update(simTime(), pending_buffer_TC3);
+}
 
+void SFU::takeSnapshot()
+{
+    Snapshot snap;
+    queue_TC2.put(snap, "queue_TC2");
+    snap.putQueue("queue_TC3", queue_TC3);
+    snap.put("fluid_backlog", fluid_backlog);
+    snap.save(Snapshot::fileName(par("snapshotDir").stringValue(), this));
+    EV << "[sfu" << getIndex() << "] snapshot taken at " << simTime() << endl;
+}
 
-
+void SFU::restoreSnapshot()
+{
+    Snapshot snap;
+    if(!snap.load(Snapshot::fileName(par("snapshotDir").stringValue(), this))) {
+        EV << "[sfu" << getIndex() << "] no snapshot found, starting with empty queues" << endl;
+        return;
+    }
+    pending_buffer_TC2 = queue_TC2.restore(snap, "queue_TC2");
+    pending_buffer_TC3 = snap.restoreQueue("queue_TC3", queue_TC3);
+    fluid_backlog = snap.get("fluid_backlog");
+    pending_buffer_TC3 += fluid_backlog;
+    occ_TC2.update(simTime(), pending_buffer_TC2);
+    occ_TC3.update(simTime(), pending_buffer_TC3);
+    EV << "[sfu" << getIndex() << "] restored " << queue_TC2.getLength() + queue_TC3.getLength() << " queued packets from snapshot" << endl;
+}
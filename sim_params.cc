@@ -9,26 +9,36 @@
 #include <math.h>
 #include <omnetpp.h>
 #include "sim_params.h"
+#include "fec.h"
 
 using namespace std;
 using namespace omnetpp;
 
-double olt_onu_distance = 20;                                           // OLT-ONU distance (km)
-double light_speed = 2e5;                                               // speed of light in fiber 2 x 10^5 km/s
-double ext_pon_link_datarate = 50e9;                                    // External PON link datarate = 50 Gbps
-double int_pon_link_datarate = 10e9;                                    // Internal PON link datarate = 10 Gbps
-double max_polling_cycle = 125e-6;                                      // maximum polling cycle duration
-
 int const pkt_sz_min = 64;                                              // Ethernet packet size - minimum (bytes)
 int const pkt_sz_max = 1542;                                            // Ethernet packet size - maximum (bytes)
 //int const pkt_sz_max = 1000;                                          // for testing 1:16 1-GPON without fragmentation
-int pkt_sz_avg = ceil((pkt_sz_min + pkt_sz_max)/2);                     // Average packet size (bytes)
-
-double onu_buffer_capacity = 100e9;                                      // ONU buffer capacity (bytes)
-double sfu_buffer_capacity = 50e9;                                      // SFU buffer capacity (bytes)
-double T_guard = 1e-6;                                                  // guard time for each ONU
-
-
-
-
-
+int const pkt_sz_avg = ceil((pkt_sz_min + pkt_sz_max)/2);               // Average packet size (bytes)
+
+int const rng_arrival = 0;                                              // module-local RNG indices, mapped to global streams in omnetpp.ini
+int const rng_size = 1;
+int const rng_dl_bkg_arrival = 2;
+int const rng_dl_bkg_size = 3;
+int const rng_dl_bkg_dest = 4;
+int const rng_fec = 5;
+int const rng_wifi = 6;
+
+void PonParams::read(cModule *network)
+{
+    oltOnuDistance = network->par("oltOnuDistance").doubleValueInUnit("km");
+    lightSpeed = 2e5;
+    extPonDatarate = network->par("extPonDatarate").doubleValueInUnit("bps");
+    intPonDatarate = network->par("intPonDatarate").doubleValueInUnit("bps");
+    maxPollingCycle = network->par("maxPollingCycle").doubleValueInUnit("s");
+    onuBufferCapacity = network->par("onuBufferCapacity").doubleValueInUnit("B");
+    sfuBufferCapacity = network->par("sfuBufferCapacity").doubleValueInUnit("B");
+    guardTime = network->par("guardTime").doubleValueInUnit("s");
+    extPonFec = network->par("extPonFec").stdstringValue();
+    intPonFec = network->par("intPonFec").stdstringValue();
+    extPonPayloadRate = extPonDatarate*Fec::codeRate(extPonFec);
+    intPonPayloadRate = intPonDatarate*Fec::codeRate(intPonFec);
+}
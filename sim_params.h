@@ -8,19 +8,47 @@
 #ifndef SIM_PARAMS_H_
 #define SIM_PARAMS_H_
 
-extern double olt_onu_distance;               // OLT-ONU distance (km)
-extern double light_speed;                    // speed of light in fiber 2 x 10^5 km/s
-extern double ext_pon_link_datarate;          // External PON link datarate = 50 Gbps
-extern double int_pon_link_datarate;          // Internal PON link datarate = 10 Gbps
-extern double max_polling_cycle;              // maximum polling cycle duration
+#include <string>
+
+namespace omnetpp { class cModule; }
+
+// PON dimensioning, read once per run from the parameters of the network (package.ned/omnetpp.ini),
+// so that one binary can run different configurations back-to-back in the same process
+struct PonParams
+{
+    double oltOnuDistance;                    // OLT-ONU distance (km), feeder + drop fibre
+    double lightSpeed;                        // speed of light in fiber 2 x 10^5 km/s
+    double extPonDatarate;                    // External PON link datarate (bps)
+    double intPonDatarate;                    // Internal PON link datarate (bps)
+    double maxPollingCycle;                   // maximum polling cycle duration (s)
+    double onuBufferCapacity;                 // ONU buffer capacity (bytes)
+    double sfuBufferCapacity;                 // SFU buffer capacity (bytes)
+    double guardTime;                         // guard time for each ONU/SFU burst (s)
+    std::string extPonFec;                    // upstream FEC of the external PON: ldpc or none
+    std::string intPonFec;                    // upstream FEC of the internal PON: rs or none
+    double extPonPayloadRate;                 // upstream payload datarate after the FEC parity (bps)
+    double intPonPayloadRate;
+
+    void read(omnetpp::cModule *network);
+};
 
 extern int const pkt_sz_min;                  // Ethernet packet size - minimum (bytes)
 extern int const pkt_sz_max;                  // Ethernet packet size - maximum (bytes)
-extern int pkt_sz_avg;                        // Average packet size (bytes)
+extern int const pkt_sz_avg;                  // Average packet size (bytes)
+
+// module-local RNG indices, every random aspect draws from its own one so that omnetpp.ini can map
+// them (rng-N) to separate global streams per traffic class
+extern int const rng_arrival;                 // inter-arrival times (sources, OLT downstream XR frames)
+extern int const rng_size;                    // packet/frame sizes (sources, OLT downstream XR frames)
+extern int const rng_dl_bkg_arrival;          // OLT downstream background arrivals
+extern int const rng_dl_bkg_size;             // OLT downstream background packet sizes
+extern int const rng_dl_bkg_dest;             // OLT downstream background destination SFU/device
+extern int const rng_fec;                     // OLT/MFU lost upstream codewords
+extern int const rng_wifi;                    // WiFi AP backoffs and collisions
 
-extern double onu_buffer_capacity;            // ONU buffer capacity (bytes)
-extern double sfu_buffer_capacity;            // SFU buffer capacity (bytes)
-extern double T_guard;                        // guard time for each ONU
+// All globals above are read-only after static initialisation. They are identical in every
+// partition of a parallel run, so nothing here needs to be kept consistent across partitions.
+// PonParams are per module instance and come from the same ini file in every partition.
 
 
 #endif /* SIM_PARAMS_H_ */
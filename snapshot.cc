@@ -0,0 +1,155 @@
+/*
+ * snapshot.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "ethPacket_m.h"
+
+std::string Snapshot::fileName(const char *dir, cModule *mod)
+{
+    std::string path(dir);
+    for(size_t i = path.find('/', 1); ; i = path.find('/', i + 1)) {     // every component, e.g. snapshot/load0.5
+        mkdir(path.substr(0, i).c_str(), 0755);
+        if(i == std::string::npos)
+            break;
+    }
+    return std::string(dir) + "/" + mod->getFullPath() + ".snap";
+}
+
+void Snapshot::put(const char *key, double value)
+{
+    values[key] = std::vector<double>(1, value);
+}
+
+void Snapshot::put(const char *key, const std::vector<double> &value)
+{
+    values[key] = value;
+}
+
+void Snapshot::putQueue(const char *key, cQueue &queue)
+{
+    std::vector<std::string> &lines = packets[key];
+    lines.clear();
+    simtime_t now = simTime();
+    for(cQueue::Iterator it(queue); !it.end(); ++it) {
+        ethPacket *pkt = check_and_cast<ethPacket *>(*it);
+        std::ostringstream os;
+        os.precision(17);
+        os << pkt->getName() << " " << pkt->getByteLength() << " " << pkt->getTContId() << " "
+           << pkt->getOnuId() << " " << pkt->getMfuId() << " " << pkt->getSfuId() << " "
+           << pkt->getDeviceId() << " " << pkt->getFragmentCount() << " "
+           << (pkt->getGenerationTime() - now).dbl() << " " << (pkt->getWapArrivalTime() - now).dbl() << " "
+           << (pkt->getSfuArrivalTime() - now).dbl() << " " << (pkt->getOnuArrivalTime() - now).dbl() << " "
+           << (pkt->getWapDepartureTime() - now).dbl() << " " << (pkt->getSfuDepartureTime() - now).dbl() << " "
+           << (pkt->getMfuArrivalTime() - now).dbl();
+        lines.push_back(os.str());
+    }
+}
+
+void Snapshot::save(const std::string &file)
+{
+    std::ofstream out(file);
+    if(!out)
+        throw cRuntimeError("cannot write snapshot file '%s'", file.c_str());
+    out.precision(17);
+    out << "time " << simTime().dbl() << "\n";
+    for(auto &v : values) {
+        out << "val " << v.first << " " << v.second.size();
+        for(double d : v.second)
+            out << " " << d;
+        out << "\n";
+    }
+    for(auto &q : packets)
+        for(auto &line : q.second)
+            out << "pkt " << q.first << " " << line << "\n";
+}
+
+bool Snapshot::load(const std::string &file)
+{
+    std::ifstream in(file);
+    if(!in)
+        return false;
+    std::string line;
+    while(std::getline(in, line)) {
+        std::istringstream is(line);
+        std::string kind, key;
+        is >> kind >> key;
+        if(kind == "val") {
+            size_t n;
+            is >> n;
+            std::vector<double> v(n);
+            for(size_t i = 0; i < n; i++)
+                is >> v[i];
+            values[key] = v;
+        }
+        else if(kind == "pkt") {
+            std::string rest;
+            std::getline(is, rest);
+            packets[key].push_back(rest);
+        }
+    }
+    return true;
+}
+
+double Snapshot::get(const char *key, double def) const
+{
+    auto it = values.find(key);
+    return (it == values.end() || it->second.empty()) ? def : it->second[0];
+}
+
+std::vector<double> Snapshot::getVector(const char *key) const
+{
+    auto it = values.find(key);
+    return (it == values.end()) ? std::vector<double>() : it->second;
+}
+
+double Snapshot::restoreQueue(const char *key, cQueue &queue) const
+{
+    auto it = packets.find(key);
+    if(it == packets.end())
+        return 0;
+    double bytes = 0;
+    simtime_t now = simTime();
+    for(auto &line : it->second) {
+        std::istringstream is(line);
+        std::string name;
+        double size, gen, wap, sfu, onu;
+        int tcont, onuId, mfuId, sfuId, dev, frag;
+        is >> name >> size >> tcont >> onuId >> mfuId >> sfuId >> dev >> frag >> gen >> wap >> sfu >> onu;
+        double wap_dep = wap, sfu_dep = sfu;        // snapshots without the departure stamps: no time spent in the AP and SFU
+        double v1, v2;
+        if(is >> v1 >> v2) {
+            wap_dep = v1;
+            sfu_dep = v2;
+        }
+        double mfu = sfu_dep;                       // nor the MFU stamp: the 10G-PON hop counts as zero
+        if(is >> v1) {
+            mfu = v1;
+        }
+        ethPacket *pkt = new ethPacket(name.c_str());
+        pkt->setByteLength(size);
+        pkt->setTContId(tcont);
+        pkt->setOnuId(onuId);
+        pkt->setMfuId(mfuId);
+        pkt->setSfuId(sfuId);
+        pkt->setDeviceId(dev);
+        pkt->setFragmentCount(frag);
+        pkt->setGenerationTime(now + gen);
+        pkt->setWapArrivalTime(now + wap);
+        pkt->setWapDepartureTime(now + wap_dep);
+        pkt->setSfuArrivalTime(now + sfu);
+        pkt->setSfuDepartureTime(now + sfu_dep);
+        pkt->setMfuArrivalTime(now + mfu);
+        pkt->setOnuArrivalTime(now + onu);
+        queue.insert(pkt);
+        bytes += size;
+    }
+    return bytes;
+}
@@ -0,0 +1,45 @@
+/*
+ * snapshot.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/*
+ * Per-module state snapshot in a small text file (<snapshotDir>/<module path>.snap).
+ * A module puts its tables and queued ethPackets in, saves, and a later run with the same
+ * topology loads the file in initialize() instead of ramping up from empty queues.
+ * Packet timestamps are stored relative to the snapshot time, so restored packets keep
+ * their age at t = 0 of the continuation run.
+ */
+class Snapshot
+{
+    private:
+        std::map<std::string, std::vector<double>> values;
+        std::map<std::string, std::vector<std::string>> packets;    // one line per queued packet, per queue
+
+    public:
+        static std::string fileName(const char *dir, cModule *mod);
+
+        void put(const char *key, double value);
+        void put(const char *key, const std::vector<double> &value);
+        void putQueue(const char *key, cQueue &queue);
+        void save(const std::string &file);
+
+        bool load(const std::string &file);
+        double get(const char *key, double def = 0) const;
+        std::vector<double> getVector(const char *key) const;
+        double restoreQueue(const char *key, cQueue &queue) const;  // returns the restored bytes
+};
+
+#endif /* SNAPSHOT_H_ */
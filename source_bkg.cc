@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -30,6 +31,8 @@ using namespace omnetpp;
 class Background_Device : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        long seqNo = 0;
         cQueue source_queue;                        // Queue for holding packets to be sent to ONUs/SFUs
         double src_queue_size;
         double Load;
@@ -39,6 +42,7 @@ class Background_Device : public cSimpleModule
         cMessage *generateEvent = nullptr;          // holds pointer to the self-timeout message
 
         //simsignal_t arrivalSignal;               // to send signals for statistics collection
+        simsignal_t dlLatencySignal;              // downstream packet latency from the OLT
 
     public:
         virtual ~Background_Device();
@@ -47,6 +51,7 @@ class Background_Device : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
         virtual ethPacket *generateNewPacket();
 };
 
@@ -64,6 +69,7 @@ Background_Device::~Background_Device()
 
 void Background_Device::initialize()
 {
+    dlLatencySignal = registerSignal("dl_bkg_latency");
     //arrivalSignal = registerSignal("generation");              // registering the signal
 
     cGate *src_gate = gate("out");
@@ -73,13 +79,17 @@ void Background_Device::initialize()
     source_queue.setName("source_queue");
     src_queue_size = 0;
 
+    if(par("fluidBackground").boolValue()) {                    // the SFU models this traffic as a fluid rate, only receive downstream
+        return;
+    }
+
     Load = par("load");                                         // get the load factor from NED file
     double R_o = par("dataRate");                                 // get the max ONU datarate from NED file
     ArrivalRate = Load*R_o/(8*pkt_sz_avg);                             // average packet arrival rate with datarate in bytes
     //EV << "[srcBkg] data rate = " << R_o << endl;
 
     // Initialize variables
-    pkt_interval = exponential(1/ArrivalRate);                  // packet inter-arrival times are generated following exponential distribution
+    pkt_interval = exponential(1/ArrivalRate, rng_arrival);                  // packet inter-arrival times are generated following exponential distribution
     generateEvent = new cMessage("generateEvent");              // self-message is generated for next packet generation
     //emit(arrivalSignal,pkt_interval);
 
@@ -92,8 +102,20 @@ void Background_Device::initialize()
 
 void Background_Device::handleMessage(cMessage *msg)
 {
-    if(strcmp(msg->getName(),"generateEvent") == 0) {
-        pkt_interval = exponential(1/ArrivalRate);              // packet inter-arrival time generation
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(source_queue.getLength());
+    if(strcmp(msg->getName(),"bkg_dl_data") == 0) {              // downstream packet from the OLT
+        ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+        if(pkt->getOnuId() == 0) {
+            double dl_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
+            EV << "[srcBkg] downstream packet_latency: " << dl_packet_latency << endl;
+            emit(dlLatencySignal, dl_packet_latency);
+        }
+        delete pkt;
+    }
+    else if(strcmp(msg->getName(),"generateEvent") == 0) {
+        pkt_interval = exponential(1/ArrivalRate, rng_arrival);              // packet inter-arrival time generation
         scheduleAt(simTime()+pkt_interval, generateEvent);      // scheduling the next packet generation
         //emit(arrivalSignal,pkt_interval);
         //EV << "[srcBkg] pkt_interval = " << pkt_interval << " and current time = " << simTime() << endl;
@@ -138,13 +160,19 @@ void Background_Device::handleMessage(cMessage *msg)
 
 ethPacket *Background_Device::generateNewPacket()
 {
-    int pkt_size = intuniform(64,1542);
+    int pkt_size = intuniform(64,1542,rng_size);
     //int pkt_size = intuniform(64,1000);             // for testing 1:16 1-GPON without fragmentation
     ethPacket *pkt = new ethPacket("bkg_data");
+    pkt->setSourceId(getId());
+    pkt->setSeqNo(seqNo++);
     pkt->setByteLength(pkt_size);                     // adding a random size payload to the packet
     pkt->setGenerationTime(simTime());
     //EV << "[srcBkg] New packet generated with size (bytes): " << pkt_size << endl;
     return pkt;
 }
 
-
+void Background_Device::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+}
@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -30,6 +31,8 @@ using namespace omnetpp;
 class Control_Device : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        long seqNo = 0;
         cQueue source_queue;                        // Queue for holding packets to be sent to ONUs/SFUs
         double src_queue_size;
         double avgPacketSize;
@@ -47,6 +50,7 @@ class Control_Device : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
         virtual ethPacket *generateNewPacket();
 };
 
@@ -79,7 +83,7 @@ void Control_Device::initialize()
     // Initialize variables
     double mean = 1e-3*(1.0/ArrivalRate);                       // mean = 10 ms
     double std = 4e-3;                                          // sd = 4 ms
-    pkt_interval = truncnormal(mean, std);                      // packet inter-arrival times are generated following gaussian distribution
+    pkt_interval = truncnormal(mean, std, rng_arrival);                      // packet inter-arrival times are generated following gaussian distribution
 
     generateEvent = new cMessage("generateEvent");              // self-message is generated for next packet generation
     //emit(arrivalSignal,pkt_interval);
@@ -93,10 +97,13 @@ void Control_Device::initialize()
 
 void Control_Device::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(source_queue.getLength());
     if(strcmp(msg->getName(),"generateEvent") == 0) {
         double mean = 1e-3*(1.0/ArrivalRate);                       // mean = 11 ms
         double std = 1e-3;                                          // sd = 1 ms
-        pkt_interval = truncnormal(mean, std);                      // packet inter-arrival times are generated following gaussian distribution
+        pkt_interval = truncnormal(mean, std, rng_arrival);                      // packet inter-arrival times are generated following gaussian distribution
         scheduleAt(simTime()+pkt_interval, generateEvent);      // scheduling the next packet generation
         //emit(arrivalSignal,pkt_interval);
         //EV << "[srcHpt] pkt_interval = " << pkt_interval << " and current time = " << simTime() << endl;
@@ -142,14 +149,16 @@ void Control_Device::handleMessage(cMessage *msg)
 ethPacket *Control_Device::generateNewPacket()
 {
     ethPacket *pkt = new ethPacket("control_data");
+    pkt->setSourceId(getId());
+    pkt->setSeqNo(seqNo++);
     pkt->setByteLength(avgPacketSize);                              // generating packets of same size
     pkt->setGenerationTime(simTime());
     //EV << "[srcCtr] New packet generated with size (bytes): " << avgPacketSize << endl;
     return pkt;
 }
 
-
-
-
-
-
+void Control_Device::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+}
@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -30,6 +31,8 @@ using namespace omnetpp;
 class HMD_Device : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        long seqNo = 0;
         cQueue source_queue;                        // Queue for holding packets to be sent to ONUs/SFUs
         double src_queue_size;
         double avgPacketSize;
@@ -39,6 +42,7 @@ class HMD_Device : public cSimpleModule
         cMessage *generateEvent = nullptr;       // holds pointer to the self-timeout message
 
     //simsignal_t arrivalSignal;               // to send signals for statistics collection
+    simsignal_t dlLatencySignal;              // downstream packet latency from the OLT
 
     public:
         virtual ~HMD_Device();
@@ -47,6 +51,7 @@ class HMD_Device : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
         virtual ethPacket *generateNewPacket();
 };
 
@@ -64,6 +69,7 @@ HMD_Device::~HMD_Device()
 
 void HMD_Device::initialize()
 {
+    dlLatencySignal = registerSignal("dl_hmd_latency");
     //arrivalSignal = registerSignal("generation");              // registering the signal
 
     cGate *src_gate = gate("out");
@@ -80,7 +86,7 @@ void HMD_Device::initialize()
     double sd = 0.5;
     double scale_b = sd*sqrt(ArrivalRate);                      // beta = sd^2/mean, assuming sd = 1 ms
     double shape_a = (1/ArrivalRate)/scale_b;                   // alpha = mean/beta
-    pkt_interval = 1e-3*gamma_d(shape_a,scale_b);               // packet inter-arrival times are generated following gamma distribution
+    pkt_interval = 1e-3*gamma_d(shape_a,scale_b,rng_arrival);               // packet inter-arrival times are generated following gamma distribution
 
     generateEvent = new cMessage("generateEvent");              // self-message is generated for next packet generation
     //emit(arrivalSignal,pkt_interval);
@@ -94,11 +100,23 @@ void HMD_Device::initialize()
 
 void HMD_Device::handleMessage(cMessage *msg)
 {
-    if(strcmp(msg->getName(),"generateEvent") == 0) {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(source_queue.getLength());
+    if(strcmp(msg->getName(),"hmd_dl_data") == 0) {              // downstream packet from the OLT
+        ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+        if(pkt->getOnuId() == 0) {
+            double dl_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
+            EV << "[srcHMD] downstream packet_latency: " << dl_packet_latency << endl;
+            emit(dlLatencySignal, dl_packet_latency);
+        }
+        delete pkt;
+    }
+    else if(strcmp(msg->getName(),"generateEvent") == 0) {
         double sd = 0.5;
         double scale_b = sd*sqrt(ArrivalRate);                      // beta = sd^2/mean, assuming sd = 1 ms
         double shape_a = (1/ArrivalRate)/scale_b;                   // alpha = mean/beta
-        pkt_interval = 1e-3*gamma_d(shape_a,scale_b);               // packet inter-arrival times are generated following gamma distribution
+        pkt_interval = 1e-3*gamma_d(shape_a,scale_b,rng_arrival);               // packet inter-arrival times are generated following gamma distribution
 
         scheduleAt(simTime()+pkt_interval, generateEvent);      // scheduling the next packet generation
         //emit(arrivalSignal,pkt_interval);
@@ -145,14 +163,16 @@ void HMD_Device::handleMessage(cMessage *msg)
 ethPacket *HMD_Device::generateNewPacket()
 {
     ethPacket *pkt = new ethPacket("hmd_data");
+    pkt->setSourceId(getId());
+    pkt->setSeqNo(seqNo++);
     pkt->setByteLength(avgPacketSize);                              // generating packets of same size
     pkt->setGenerationTime(simTime());
     //EV << "[srcHMD] New packet generated with size (bytes): " << avgPacketSize << endl;
     return pkt;
 }
 
-
-
-
-
-
+void HMD_Device::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+}
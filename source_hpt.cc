@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -30,6 +31,8 @@ using namespace omnetpp;
 class Haptic_Device : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        long seqNo = 0;
         cQueue source_queue;                        // Queue for holding packets to be sent to ONUs/SFUs
         double src_queue_size;
         double avgPacketSize;
@@ -47,6 +50,7 @@ class Haptic_Device : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
         virtual ethPacket *generateNewPacket();
 };
 
@@ -84,7 +88,7 @@ void Haptic_Device::initialize()
     double b = mean * (a - 1) / a;
     double c = 0.0;
 
-    pkt_interval = pareto_shifted(a, b, c);                      // packet inter-arrival times are generated following GP distribution
+    pkt_interval = pareto_shifted(a, b, c, rng_arrival);                      // packet inter-arrival times are generated following GP distribution
 
     generateEvent = new cMessage("generateEvent");              // self-message is generated for next packet generation
     //emit(arrivalSignal,pkt_interval);
@@ -98,6 +102,9 @@ void Haptic_Device::initialize()
 
 void Haptic_Device::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(source_queue.getLength());
     if(strcmp(msg->getName(),"generateEvent") == 0) {
         double mean = 1e-3*(1.0/ArrivalRate);                       // mean = 10 ms
         double std = 4e-3;                                          // sd = 4 ms
@@ -106,7 +113,7 @@ void Haptic_Device::handleMessage(cMessage *msg)
         double b = mean * (a - 1) / a;
         double c = 0.0;
 
-        pkt_interval = pareto_shifted(a, b, c);                      // packet inter-arrival times are generated following GP distribution
+        pkt_interval = pareto_shifted(a, b, c, rng_arrival);                      // packet inter-arrival times are generated following GP distribution
         scheduleAt(simTime()+pkt_interval, generateEvent);      // scheduling the next packet generation
         //emit(arrivalSignal,pkt_interval);
         //EV << "[srcHpt] pkt_interval = " << pkt_interval << " and current time = " << simTime() << endl;
@@ -152,10 +159,16 @@ void Haptic_Device::handleMessage(cMessage *msg)
 ethPacket *Haptic_Device::generateNewPacket()
 {
     ethPacket *pkt = new ethPacket("haptic_data");
+    pkt->setSourceId(getId());
+    pkt->setSeqNo(seqNo++);
     pkt->setByteLength(avgPacketSize);                              // generating packets of same size
     pkt->setGenerationTime(simTime());
     //EV << "[srcHpt] New packet generated with size (bytes): " << avgPacketSize << endl;
     return pkt;
 }
 
-
+void Haptic_Device::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+}
@@ -10,8 +10,11 @@
 #include <omnetpp.h>
 #include <numeric>   // Required for std::iota
 #include <algorithm> // Required for std::sort
+#include <deque>
 
 #include "sim_params.h"
+#include "profiling.h"
+#include "xr_trace.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -25,11 +28,29 @@ using namespace omnetpp;
  * SourceApp and average packet size.
  * The generateEvent is a self-message which is scheduled back-to-back to create
  * a new packet. Immediately the packet is transmitted to the corresponding ONU.
+ *
+ * In packet-train mode a frame is kept as a single descriptor (size, start time,
+ * packet count) and its packets are only created one at a time when the wireless
+ * channel becomes free, so a frame costs one timer instead of one per packet.
+ *
+ * With traceFile set, frame sizes and inter-frame times are replayed from a recorded
+ * encoder trace instead of being drawn. All devices share one memory mapping of the
+ * trace and start at different frames (traceOffset), wrapping around at its end.
  */
 
+struct FrameDescriptor
+{
+    double frameSize;                           // total frame size (bytes)
+    simtime_t startTime;                        // frame generation time, stamped on all its packets
+    int num_pkts;                               // number of packets the frame is split into
+    int sent_pkts;                              // packets already materialised and sent
+};
+
 class XR_Device : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
+        long seqNo = 0;
         cQueue source_queue;                        // Queue for holding packets to be sent to ONUs/SFUs
         double src_queue_size;
         double avgFrameSize;
@@ -38,9 +59,16 @@ class XR_Device : public cSimpleModule
         double pkt_interval;                     // inter-packet generation interval
         double pkt_size;
         double wireless_datarate;
+        bool packetTrain;                        // lazy per-frame packet generation
+        std::deque<FrameDescriptor> frame_queue; // frames waiting to be sent in packet-train mode
         cMessage *generateEvent = nullptr;       // holds pointer to the self-timeout message
+        cMessage *trainTxEvent = nullptr;        // single transmit timer used in packet-train mode
+        XrTrace *trace = nullptr;                // shared mapping of the replayed trace, nullptr = synthetic frames
+        size_t trace_pos = 0;                    // next frame of the trace
+        long trace_iframes = 0;
 
         //simsignal_t arrivalSignal;               // to send signals for statistics collection
+        simsignal_t dlLatencySignal;              // downstream packet latency from the OLT
 
     public:
         virtual ~XR_Device();
@@ -49,7 +77,12 @@ class XR_Device : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
         virtual ethPacket *generateNewPacket();
+        virtual simtime_t queueDelay();
+        virtual void enqueueFrame(double frameSize);
+        virtual void sendNextTrainPacket();
+        virtual void nextTraceFrame(double &interval, double &frameSize);
 };
 
 // The module class needs to be registered with OMNeT++
@@ -58,6 +91,8 @@ Define_Module(XR_Device);
 XR_Device::~XR_Device()
 {
     cancelAndDelete(generateEvent);
+    cancelAndDelete(trainTxEvent);
+    XrTrace::release(trace);
     // Clean up queues
     while (!source_queue.isEmpty()) {
         delete source_queue.pop();
@@ -66,6 +101,7 @@ XR_Device::~XR_Device()
 
 void XR_Device::initialize()
 {
+    dlLatencySignal = registerSignal("dl_xr_latency");
     //arrivalSignal = registerSignal("generation");               // registering the signal
 
     cGate *src_gate = gate("out");
@@ -77,18 +113,36 @@ void XR_Device::initialize()
 
     avgDataRate = par("dataRate");                              // get the load factor from NED file
     ArrivalRate = par("frameRate");                             // get the max ONU datarate from NED file
+    packetTrain = par("packetTrain");                           // frame-level packet train generation
 
     // Initialize variables
     double mean = 1.0/ArrivalRate;
     double std = 2e-3;                                          // std = 2 msec
-    pkt_interval = truncnormal(mean, std);                       // packet inter-arrival times are generated following truncnormal distribution
+    pkt_interval = truncnormal(mean, std, rng_arrival);                       // packet inter-arrival times are generated following truncnormal distribution
     generateEvent = new cMessage("generateEvent");              // self-message is generated for next packet generation
     //emit(arrivalSignal,pkt_interval);
 
     avgFrameSize = avgDataRate/(8*ArrivalRate);                        // framesize = datarate (bps)/(8*fps)
-    double frameSize = truncnormal(avgFrameSize, 0.105*avgFrameSize);
+    double frameSize = truncnormal(avgFrameSize, 0.105*avgFrameSize, rng_size);
     //double frameSize = 0.5*avgFrameSize;
 
+    string trace_file = par("traceFile").stdstringValue();
+    if(!trace_file.empty()) {                                   // replay a recorded trace instead
+        trace = XrTrace::acquire(trace_file);
+        long offset = par("traceOffset");
+        if(offset < 0)                                          // spread the headsets evenly over the trace
+            offset = (long)(getIndex()*trace->getFrames()/getVectorSize());
+        trace_pos = offset % trace->getFrames();
+        nextTraceFrame(pkt_interval, frameSize);
+    }
+
+    if(packetTrain) {
+        trainTxEvent = new cMessage("Train_Tx_Delay");
+        enqueueFrame(frameSize);                                // only the frame descriptor is stored
+        scheduleAt(simTime()+pkt_interval, generateEvent);      // scheduling the next frame generation
+        return;
+    }
+
     int num_pkts = ceil(frameSize/1500);
     //EV << "[srcXR" << getIndex() << "] frame size = " << frameSize << ", num_pkts = "<< num_pkts << " and current time = " << simTime() << endl;
 
@@ -100,7 +154,7 @@ void XR_Device::initialize()
         source_queue.insert(pkt);
 
         cMessage *src_tx = new cMessage("Source_Tx_Delay");
-        scheduleAt(simTime()+(simtime_t)(src_queue_size*8/wireless_datarate),src_tx);
+        scheduleAt(simTime()+queueDelay(),src_tx);
         src_queue_size += pkt->getByteLength();
     }
     // sending the last packet
@@ -110,7 +164,7 @@ void XR_Device::initialize()
     source_queue.insert(pkt);
 
     cMessage *src_tx = new cMessage("Source_Tx_Delay");
-    scheduleAt(simTime()+(simtime_t)(src_queue_size*8/wireless_datarate),src_tx);
+    scheduleAt(simTime()+queueDelay(),src_tx);
     src_queue_size += pkt->getByteLength();
 
     scheduleAt(simTime()+pkt_interval, generateEvent);          // scheduling the next packet generation
@@ -118,18 +172,41 @@ void XR_Device::initialize()
 
 void XR_Device::handleMessage(cMessage *msg)
 {
-    if(strcmp(msg->getName(),"generateEvent") == 0) {
-        double mean = 1.0/ArrivalRate;
-        double std = 2e-3;
-        pkt_interval = truncnormal(mean, std);                       // packet inter-arrival times are generated following truncnormal distribution
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(source_queue.getLength());
+    if(strcmp(msg->getName(),"xr_dl_data") == 0) {              // downstream packet from the OLT
+        ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+        if(pkt->getOnuId() == 0) {
+            double dl_packet_latency = pkt->getArrivalTime().dbl() - pkt->getGenerationTime().dbl();
+            EV << "[srcXR" << getIndex() << "] downstream packet_latency: " << dl_packet_latency << endl;
+            emit(dlLatencySignal, dl_packet_latency);
+        }
+        delete pkt;
+    }
+    else if(strcmp(msg->getName(),"generateEvent") == 0) {
+        double frameSize;
+        if(trace != nullptr) {
+            nextTraceFrame(pkt_interval, frameSize);
+        }
+        else {
+            double mean = 1.0/ArrivalRate;
+            double std = 2e-3;
+            pkt_interval = truncnormal(mean, std, rng_arrival);                       // packet inter-arrival times are generated following truncnormal distribution
+            frameSize = truncnormal(avgFrameSize, 0.105*avgFrameSize, rng_size);
+        }
 
         scheduleAt(simTime()+pkt_interval, generateEvent);          // scheduling the next packet generation
         //emit(arrivalSignal,pkt_interval);
         //EV << "[srcXR" << getIndex() << "] pkt_interval = " << pkt_interval << " and current time = " << simTime() << endl;
 
-        double frameSize = truncnormal(avgFrameSize, 0.105*avgFrameSize);
         //double frameSize = 0.5*avgFrameSize;
         //EV << "[srcXR" << getIndex() << "] frame size = " << frameSize << " and current time = " << simTime() << endl;
+        if(packetTrain) {
+            enqueueFrame(frameSize);
+            return;
+        }
+
         int num_pkts = ceil(frameSize/1500);
         //EV << "[srcXR" << getIndex() << "] frame size = " << frameSize << ", num_pkts = "<< num_pkts << " and current time = " << simTime() << endl;
 
@@ -140,7 +217,7 @@ void XR_Device::handleMessage(cMessage *msg)
             source_queue.insert(pkt);
 
             cMessage *src_tx = new cMessage("Source_Tx_Delay");
-            scheduleAt(simTime()+(simtime_t)(src_queue_size*8/wireless_datarate),src_tx);
+            scheduleAt(simTime()+queueDelay(),src_tx);
             src_queue_size += pkt->getByteLength();
         }
         // sending the last packet
@@ -150,9 +227,12 @@ void XR_Device::handleMessage(cMessage *msg)
         source_queue.insert(pkt);
 
         cMessage *src_tx = new cMessage("Source_Tx_Delay");
-        scheduleAt(simTime()+(simtime_t)(src_queue_size*8/wireless_datarate),src_tx);
+        scheduleAt(simTime()+queueDelay(),src_tx);
         src_queue_size += pkt->getByteLength();
     }
+    else if(strcmp(msg->getName(),"Train_Tx_Delay") == 0) {
+        sendNextTrainPacket();
+    }
     else if(strcmp(msg->getName(),"Source_Tx_Delay") == 0) {
         delete msg;
 
@@ -183,10 +263,99 @@ void XR_Device::handleMessage(cMessage *msg)
 ethPacket *XR_Device::generateNewPacket()
 {
     ethPacket *pkt = new ethPacket("xr_data");
+    pkt->setSourceId(getId());
+    pkt->setSeqNo(seqNo++);
     pkt->setByteLength(pkt_size);                              // generating packets of same size
     pkt->setGenerationTime(simTime());
     //EV << "[srcXR" << getIndex() << "] New packet generated with size (bytes): " << pkt_size << endl;
     return pkt;
 }
 
+// airtime of the packets already queued; with the MAC of the AP (mac != "none") the wireless
+// channel has no datarate and the AP accounts for the airtime, so packets leave at once
+simtime_t XR_Device::queueDelay()
+{
+    if(wireless_datarate <= 0)
+        return 0;
+    return (simtime_t)(src_queue_size*8/wireless_datarate);
+}
+
+void XR_Device::enqueueFrame(double frameSize)
+{
+    FrameDescriptor frame;
+    frame.frameSize = frameSize;
+    frame.startTime = simTime();
+    frame.num_pkts = ceil(frameSize/1500);
+    frame.sent_pkts = 0;
+    frame_queue.push_back(frame);
+    //EV << "[srcXR" << getIndex() << "] frame queued with size = " << frameSize << ", num_pkts = " << frame.num_pkts << endl;
+
+    if(!trainTxEvent->isScheduled()) {                  // the train is idle, start sending the new frame
+        cChannel *src_ch = gate("out")->getChannel();
+        if(src_ch->isBusy() == false) {
+            sendNextTrainPacket();
+        }
+        else {
+            scheduleAt(src_ch->getTransmissionFinishTime(), trainTxEvent);
+        }
+    }
+}
+
+void XR_Device::sendNextTrainPacket()
+{
+    if(frame_queue.empty())
+        return;
+
+    cChannel *src_ch = gate("out")->getChannel();
+    if(src_ch->isBusy() == true) {                      // just to be sure that the channel is free now
+        scheduleAt(src_ch->getTransmissionFinishTime(), trainTxEvent);
+        return;
+    }
+
+    FrameDescriptor& frame = frame_queue.front();
+    if(frame.sent_pkts < frame.num_pkts-1) {
+        pkt_size = 1542;
+    }
+    else {                                              // the last packet carries the rest of the frame
+        int pending = ceil(frame.frameSize-(frame.num_pkts-1)*1500);
+        pkt_size = min(1500,pending)+42;
+    }
+    ethPacket *pkt = generateNewPacket();
+    pkt->setGenerationTime(frame.startTime);            // all packets of a frame are generated together
+    send(pkt,"out");
+
+    frame.sent_pkts += 1;
+    if(frame.sent_pkts >= frame.num_pkts) {
+        frame_queue.pop_front();
+    }
 
+    if(!frame_queue.empty()) {                          // next packet goes out when the channel frees up
+        scheduleAt(src_ch->getTransmissionFinishTime(), trainTxEvent);
+    }
+}
+
+void XR_Device::nextTraceFrame(double &interval, double &frameSize)
+{
+    const XrTraceFrame &frame = trace->getFrame(trace_pos);
+    frameSize = std::max<uint32_t>(frame.size, 1);         // an empty frame still costs one packet
+    trace_iframes += frame.type;
+
+    trace_pos++;
+    if(trace_pos < trace->getFrames()) {
+        interval = trace->getFrame(trace_pos).time - frame.time;
+    }
+    else {                                              // wrap around, one nominal frame period between the passes
+        trace_pos = 0;
+        interval = 1.0/ArrivalRate;
+    }
+    if(interval <= 0)                                   // duplicate or reordered timestamps in the recording
+        interval = 1.0/ArrivalRate;
+}
+
+void XR_Device::finish()
+{
+    recordScalar("numEvents", numEvents);
+    if(trace != nullptr)
+        recordScalar("traceIFrames", trace_iframes);
+    FTTR_PROFILE_DUMP();
+}
@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -22,20 +23,39 @@ using namespace omnetpp;
 class Splitter : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
         cQueue onu_queue;            // Queue for packets to be sent to ONUs
         cQueue olt_queue;            // Queue for packets to be sent to OLT
+        vector<cQueue *> dl_queue;   // per-port queues for downstream packets when the port is busy
         double onu_queue_size;
         double olt_queue_size;
-        double pon_datarate;
+        double pon_datarate;         // upstream rate towards the OLT/MFU, read when queuing as the head end lowers it to the FEC payload rate
+        bool internal;               // splitter of the 10G-PON behind an MFU
+
+    public:
+        virtual ~Splitter();
 
     protected:
        // The following redefined virtual function holds the algorithm.
        virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
+        virtual void sendDownstream(cPacket *pkt, int k);
+        virtual gtc_header *portCopy(gtc_header *pkt, int k);
 };
 
 Define_Module(Splitter);
 
+Splitter::~Splitter()
+{
+    for(auto q : dl_queue) {
+        while (!q->isEmpty()) {
+            delete q->pop();
+        }
+        delete q;
+    }
+}
+
 void Splitter::initialize()
 {
     onu_queue.setName("onu_queue");
@@ -43,22 +63,22 @@ void Splitter::initialize()
     olt_queue_size = 0;
     onu_queue_size = 0;
 
-    cGate *g = gate("OltGate_o");                   // get the gate
-    cChannel *ch = g->getChannel();                 // get the channel object
-    if (ch != nullptr) {
-        pon_datarate = ch->par("datarate").doubleValue();  // in bits per second
-    }
+    internal = par("internal");
 
     // Make sure incoming message is delivered immediately
     gate("OltGate_i")->setDeliverImmediately(true);
     int n = gateSize("OnuGate_o");
     for (int k = 0; k < n; k++) {
         gate("OnuGate_i",k)->setDeliverImmediately(true);
+        dl_queue.push_back(new cQueue("dl_queue"));
     }
 }
 
 void Splitter::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
+    FTTR_PROFILE_QUEUE(onu_queue.getLength()+olt_queue.getLength());
     if(msg->isPacket() == true) {
         //EV << "[splt] input received as packet!" << endl;
         if(msg->arrivedOn("OltGate_i") == true) {     // any message arriving from OLT are broadcasted to all ONUs
@@ -68,27 +88,16 @@ void Splitter::handleMessage(cMessage *msg)
                 int n = gateSize("OnuGate_o");
                 for (int k = 0; k < n; k++) {
                     //EV << "[splt] sending packet to ONU-"<< k <<" at "<< simTime() << endl;
-                    cGate *onu_gate = gate("OnuGate_o",k);
-                    cChannel *onu_ch = onu_gate->getChannel();
-                    if((onu_ch->isBusy() == false)&&(onu_queue.getLength() == 0)) {
-                        gtc_header *copy = pkt->dup();       // creating a copy for all and sending immediately
-                        send(copy,"OnuGate_o",k);
-                    }
-                    else {
-                        gtc_header *copy = pkt->dup();
-                        if(pkt->getExt_pon())
-                            copy->setOnuID(k);                  // set the OnuID with the current value k
-                        else if(pkt->getInt_pon())
-                            copy->setSfuID(k);
-                        onu_queue.insert(copy);
-
-                        cMessage *onu_tx = new cMessage("ONU_Tx_Delay");
-                        scheduleAt(onu_ch->getTransmissionFinishTime()+(simtime_t)(onu_queue_size*8/pon_datarate),onu_tx);
-                        onu_queue_size += copy->getByteLength();
-                    }
+                    gtc_header *copy = portCopy(pkt, k);    // each port only gets its own bandwidth map entry
+                    sendDownstream(copy, k);                // queued if the port is still busy with downstream payload
                 }
                 delete pkt;
             }
+            else {                                      // downstream payload only goes to the addressed port
+                ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+                int k = internal ? (pkt->getSfuId() % gateSize("OnuGate_o")) : pkt->getOnuId();
+                sendDownstream(pkt, k);
+            }
         }
         else if(msg->arrivedOn("OnuGate_i") == true){
             cGate *olt_gate = gate("OltGate_o");
@@ -99,6 +108,7 @@ void Splitter::handleMessage(cMessage *msg)
             }
             else {
                 EV << "[splt] channel busy so queuing for OLT at "<< simTime() << endl;
+                pon_datarate = check_and_cast<cDatarateChannel *>(olt_ch)->getDatarate();     // in bits per second
                 if (strcmp(msg->getName(), "gtc_hdr_ul") == 0) {
                     gtc_header *pkt = check_and_cast<gtc_header *>(msg);
                     olt_queue.insert(pkt);
@@ -109,7 +119,7 @@ void Splitter::handleMessage(cMessage *msg)
                     EV << "[splt] gtc_hdr_ul queued; OLT_Tx_Delay at: " << olt_ch->getTransmissionFinishTime()+(simtime_t)(olt_queue_size*8/pon_datarate) << ", Queue size = " << olt_queue_size << endl;
                 }
 
-                if (strcmp(msg->getName(), "bkg_data") == 0) {
+                if ((strcmp(msg->getName(), "bkg_data") == 0)||(strcmp(msg->getName(), "bkg_fluid") == 0)) {
                     ethPacket *pkt = check_and_cast<ethPacket *>(msg);
                     olt_queue.insert(pkt);
 
@@ -159,6 +169,23 @@ void Splitter::handleMessage(cMessage *msg)
     }
     else {
         if(msg->isSelfMessage()) {
+            if(strcmp(msg->getName(),"DL_Tx_Delay") == 0) {
+                int k = msg->getKind();
+                cChannel *onu_ch = gate("OnuGate_o",k)->getChannel();
+                if(onu_ch->isBusy() == true) {
+                    scheduleAt(onu_ch->getTransmissionFinishTime(), msg);
+                }
+                else {
+                    send((cPacket *)dl_queue[k]->pop(),"OnuGate_o",k);
+                    if(!dl_queue[k]->isEmpty()) {
+                        scheduleAt(onu_ch->getTransmissionFinishTime(), msg);
+                    }
+                    else {
+                        delete msg;
+                    }
+                }
+                return;
+            }
             if(strcmp(msg->getName(),"OLT_Tx_Delay") == 0) {
                 EV << "[splt] OLT_Tx_Delay detected!"<< endl;
                 cancelAndDelete(msg);
@@ -170,7 +197,7 @@ void Splitter::handleMessage(cMessage *msg)
                     EV << "[splt] Sent delayed gtc_hdr_ul at: " << simTime() << endl;
                     olt_queue_size -= pkt->getByteLength();
                 }
-                if(strcmp(olt_queue.front()->getName(),"bkg_data") == 0) {
+                if((strcmp(olt_queue.front()->getName(),"bkg_data") == 0)||(strcmp(olt_queue.front()->getName(),"bkg_fluid") == 0)) {
                     EV << "[splt] sending bkg_data packet to OLT at "<< simTime() << endl;
                     ethPacket *pkt = (ethPacket *)olt_queue.pop();
                     send(pkt,"OltGate_o");
@@ -230,4 +257,64 @@ void Splitter::handleMessage(cMessage *msg)
     }
 }
 
+void Splitter::sendDownstream(cPacket *pkt, int k)
+{
+    cChannel *onu_ch = gate("OnuGate_o",k)->getChannel();
+    if((onu_ch->isBusy() == false)&&(dl_queue[k]->isEmpty())) {
+        send(pkt,"OnuGate_o",k);
+    }
+    else {
+        dl_queue[k]->insert(pkt);
+        if(dl_queue[k]->getLength() == 1) {             // first waiting packet, the port needs a timer
+            cMessage *dl_tx = new cMessage("DL_Tx_Delay");
+            dl_tx->setKind(k);
+            scheduleAt(onu_ch->getTransmissionFinishTime(), dl_tx);
+        }
+    }
+}
 
+gtc_header *Splitter::portCopy(gtc_header *pkt, int k)
+{
+    // a full dup() would copy the whole bandwidth map to every port, which grows with the square of the split
+    gtc_header *copy = new gtc_header(pkt->getName());
+    copy->setByteLength(pkt->getByteLength());          // the full header is still on the fibre
+    copy->setDownlink(pkt->getDownlink());
+    copy->setExt_pon(pkt->getExt_pon());
+    copy->setInt_pon(pkt->getInt_pon());
+    copy->setMfuID(pkt->getMfuID());
+    copy->setSeqID(pkt->getSeqID());
+    copy->setTeqd(pkt->getTeqd());
+    if(pkt->getExt_pon()) {
+        copy->setOnuID(k);                              // set the OnuID with the current value k
+        copy->setOlt_onu_rttArraySize(1);
+        copy->setOlt_onu_rtt(0, pkt->getOlt_onu_rtt(k));
+        copy->setOnu_start_time_TC2ArraySize(1);
+        copy->setOnu_start_time_TC2(0, pkt->getOnu_start_time_TC2(k));
+        copy->setOnu_grant_TC2ArraySize(1);
+        copy->setOnu_grant_TC2(0, pkt->getOnu_grant_TC2(k));
+        copy->setOnu_start_time_TC3ArraySize(1);
+        copy->setOnu_start_time_TC3(0, pkt->getOnu_start_time_TC3(k));
+        copy->setOnu_grant_TC3ArraySize(1);
+        copy->setOnu_grant_TC3(0, pkt->getOnu_grant_TC3(k));
+    }
+    else if(pkt->getInt_pon()) {
+        copy->setSfuID(k);
+        copy->setMfu_sfu_rttArraySize(1);
+        copy->setMfu_sfu_rtt(0, pkt->getMfu_sfu_rtt(k));
+        copy->setSfu_start_time_TC2ArraySize(1);
+        copy->setSfu_start_time_TC2(0, pkt->getSfu_start_time_TC2(k));
+        copy->setSfu_grant_TC2ArraySize(1);
+        copy->setSfu_grant_TC2(0, pkt->getSfu_grant_TC2(k));
+        copy->setSfu_start_time_TC3ArraySize(1);
+        copy->setSfu_start_time_TC3(0, pkt->getSfu_start_time_TC3(k));
+        copy->setSfu_grant_TC3ArraySize(1);
+        copy->setSfu_grant_TC3(0, pkt->getSfu_grant_TC3(k));
+    }
+    return copy;
+}
+
+void Splitter::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+}
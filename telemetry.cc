@@ -0,0 +1,106 @@
+/*
+ * telemetry.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <omnetpp.h>
+
+#include "telemetry.h"
+
+using namespace omnetpp;
+
+static const size_t header_size = 64;
+
+std::map<std::string, Telemetry *> Telemetry::registry;
+
+Telemetry *Telemetry::attach(const std::string &name, int onus, int sfus, double wallInterval)
+{
+    auto it = registry.find(name);
+    if(it != registry.end()) {
+        it->second->refs++;
+        return it->second;
+    }
+
+    Telemetry *t = new Telemetry();
+    t->name = name;
+    t->onus = onus;
+    t->sfus = sfus;
+    t->wallInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(wallInterval));
+    t->mapLength = header_size + blockSize(onus) + onus*blockSize(sfus);
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, t->mapLength) != 0) {
+        delete t;
+        throw cRuntimeError("cannot create telemetry segment '%s'", name.c_str());
+    }
+    void *m = mmap(nullptr, t->mapLength, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED) {
+        delete t;
+        throw cRuntimeError("cannot map telemetry segment '%s'", name.c_str());
+    }
+    t->map = (char *)m;
+    memset(t->map, 0, t->mapLength);
+    memcpy(t->map, "FTTRTEL1", 8);
+    uint32_t hdr[4] = {(uint32_t)onus, (uint32_t)sfus, 0, (uint32_t)getpid()};
+    memcpy(t->map + 8, hdr, sizeof(hdr));
+
+    t->refs = 1;
+    registry[name] = t;
+    return t;
+}
+
+void Telemetry::detach(Telemetry *t)
+{
+    if(t == nullptr || --t->refs > 0)
+        return;
+    registry.erase(t->name);
+    munmap(t->map, t->mapLength);
+    shm_unlink(t->name.c_str());                // an attached viewer keeps its mapping until it exits
+    delete t;
+}
+
+bool Telemetry::due(int block)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto &last = lastPublish[block];
+    if(now - last < wallInterval)
+        return false;
+    last = now;
+    return true;
+}
+
+static uint64_t *block_seq(char *map, int block, int onus, int sfus)
+{
+    size_t off = header_size;
+    if(block >= 0)
+        off += Telemetry::blockSize(onus) + block*Telemetry::blockSize(sfus);
+    return (uint64_t *)(map + off);
+}
+
+double *Telemetry::begin(int block)
+{
+    uint64_t *seq = block_seq(map, block, onus, sfus);
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);         // odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    return (double *)(seq + 1);
+}
+
+void Telemetry::end(int block)
+{
+    uint64_t *seq = block_seq(map, block, onus, sfus);
+    std::atomic_thread_fence(std::memory_order_release);
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);         // even: consistent again
+}
+
+bool Telemetry::stopRequested() const
+{
+    return __atomic_load_n((uint32_t *)(map + 16), __ATOMIC_RELAXED) != 0;
+}
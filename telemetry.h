@@ -0,0 +1,60 @@
+/*
+ * telemetry.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <string>
+
+/*
+ * Live DBA telemetry in a POSIX shared-memory segment, watched with tools/telemetry_view.py.
+ * The OLT and every MFU own one block of the segment and overwrite it in place at most every
+ * wallInterval seconds of wall-clock time; a viewer maps the segment read-only and may attach
+ * and detach at any time without the simulation noticing. Every block is guarded by a seqlock:
+ * its sequence number is odd while the writer updates it, a reader retries until it sees the
+ * same even number before and after copying.
+ *
+ * segment: header (64 B) | OLT block | MFU block 0 .. onus-1
+ * header:  "FTTRTEL1", uint32 onus, uint32 sfus, uint32 stop (set by the viewer), uint32 pid
+ * block:   uint64 seq, float64 simTime, float64 events, float64 dlQueueBytes,
+ *          float64 latency[5 classes][p50, p99, samples], float64 entry[n][bufTC2, bufTC3, grantTC2, grantTC3]
+ *          (n = onus for the OLT, sfus for an MFU; the latency fields are only filled by the OLT)
+ */
+class Telemetry
+{
+    private:
+        std::string name;
+        char *map = nullptr;
+        size_t mapLength = 0;
+        int onus = 0;
+        int sfus = 0;
+        int refs = 0;
+        std::chrono::steady_clock::duration wallInterval;
+        std::map<int, std::chrono::steady_clock::time_point> lastPublish;
+
+        static std::map<std::string, Telemetry *> registry;
+
+    public:
+        static const int num_classes = 5;
+        static const int fields = 4;            // per ONU/SFU entry
+
+        static Telemetry *attach(const std::string &name, int onus, int sfus, double wallInterval);
+        static void detach(Telemetry *t);
+
+        bool due(int block);                    // -1 = OLT, k = MFU k; true once wallInterval has passed
+        double *begin(int block);               // starts an update, returns the payload after seq
+        void end(int block);
+        bool stopRequested() const;
+
+        static size_t blockSize(int entries) { return 8 + 8*(3 + 3*num_classes + fields*entries); }
+};
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Simulator performance benchmark: fixed topologies, loads and seeds, results as JSON.
+
+Runs every run of [Config Bench] (4x2, 16x8 and 64x16 topologies at load 0.1/0.5/1.0 with a
+fixed seed set) one after the other and reports per run:
+  events/s, wall-clock seconds per simulated second, peak RSS, objects created per event
+  (message/packet allocations) and the handled events per module type, summed from the numEvents
+  scalar that every simple module records in finish().
+Two result files of different commits can be compared with --baseline; runs that became slower
+than --threshold are listed and make the script exit with status 1.
+
+usage: bench.py [--exe ./fttr] [-c Bench] [--sim-time 0.02s] [-o bench.json] [--baseline old.json]
+"""
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+from run_sweep import parse_sca, query_numruns
+from scale_bench import query_itervars
+
+
+# every simple module type of the network records numEvents; a type missing from a run's counts means a
+# module stopped recording it and the per-module breakdown no longer adds up to totalEvents
+MODULE_TYPES = ['olt', 'splitter_ext', 'splitter_int', 'onus', 'mfus', 'sfus', 'waps',
+                'xrs', 'hmds', 'controls', 'haptics', 'bkgs1', 'bkgs2', 'bkgs3']
+
+
+def module_type(path):
+    """FTTR_50G_10GPON_v2.sfus[12] -> sfus"""
+    return re.sub(r'\[\d+\]', '', path.split('.')[-1])
+
+
+def bench_run(exe, ini, config, run, sim_time, outdir):
+    """returns a dict with the measurements of one run"""
+    sca = os.path.join(outdir, 'bench%04d.sca' % run)
+    cmd = [exe, '-u', 'Cmdenv', '-f', ini, '-c', config, '-r', str(run),
+           '--cmdenv-express-mode=true', '--sim-time-limit=' + sim_time,
+           '--result-dir=' + outdir, '--output-scalar-file=' + sca]
+    start = time.time()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+
+    events, created, per_type = 0, 0, {}
+    if os.path.exists(sca):
+        for _, module, name, value in parse_sca(sca):
+            if name == 'numEvents':
+                t = module_type(module)
+                per_type[t] = per_type.get(t, 0) + int(float(value))
+            elif name == 'totalEvents':
+                events = int(float(value))
+            elif name == 'objectsCreated':
+                created = int(float(value))
+    sim_secs = float(sim_time.rstrip('s'))
+    return dict(exit=os.waitstatus_to_exitcode(status), wall_s=wall, events=events,
+                events_per_s=events / wall if wall > 0 else 0, wall_per_simsec=wall / sim_secs,
+                peak_rss_mb=usage.ru_maxrss / 1024.0,            # ru_maxrss is in kB on Linux
+                objects_per_event=created / events if events else 0, module_events=per_type)
+
+
+def git_commit():
+    try:
+        return subprocess.run(['git', 'rev-parse', '--short', 'HEAD'], capture_output=True,
+                              text=True, check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ''
+
+
+def compare(results, baseline, threshold):
+    """prints the wall time per simulated second against the baseline, returns the regressions"""
+    old = {(r['onus'], r['sfus'], r['load']): r for r in baseline['runs']}
+    slower = []
+    for r in results:
+        b = old.get((r['onus'], r['sfus'], r['load']))
+        if not b or not b['wall_per_simsec']:
+            continue
+        ratio = r['wall_per_simsec'] / b['wall_per_simsec']
+        print('%4dx%-3d load %.1f: %8.1f -> %8.1f s/simsec (%+.1f%%)' % (r['onus'], r['sfus'], r['load'],
+              b['wall_per_simsec'], r['wall_per_simsec'], 100 * (ratio - 1)))
+        if ratio > 1 + threshold:
+            slower.append(r)
+    return slower
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--exe', default='./fttr')
+    ap.add_argument('-f', '--ini', default='omnetpp.ini')
+    ap.add_argument('-c', '--config', default='Bench')
+    ap.add_argument('--sim-time', default='0.02s', help='simulated time per run')
+    ap.add_argument('-o', '--output', default='bench.json')
+    ap.add_argument('--baseline', default=None, help='bench.json of an earlier commit to compare with')
+    ap.add_argument('--threshold', type=float, default=0.05, help='relative slowdown reported as regression')
+    args = ap.parse_args()
+
+    itervars = query_itervars(args.exe, args.ini, args.config)
+    results = []
+    with tempfile.TemporaryDirectory(prefix='fttr-bench-') as outdir:
+        for run in range(query_numruns(args.exe, args.ini, args.config)):
+            v = itervars.get(run, {})
+            r = dict(run=run, onus=int(v.get('onus', 0)), sfus=int(v.get('sfus', 0)), load=float(v.get('load', 0)))
+            r.update(bench_run(args.exe, args.ini, args.config, run, args.sim_time, outdir))
+            results.append(r)
+            print('%4dx%-3d load %.1f: %10.0f events/s %8.1f s/simsec %8.1f MB %6.2f obj/event%s' % (
+                  r['onus'], r['sfus'], r['load'], r['events_per_s'], r['wall_per_simsec'], r['peak_rss_mb'],
+                  r['objects_per_event'], '' if r['exit'] == 0 else '  (exit %d)' % r['exit']))
+            missing = [t for t in MODULE_TYPES if t not in r['module_events']]
+            if r['exit'] == 0 and missing:
+                print('    no numEvents recorded by: %s' % ', '.join(missing))
+            sys.stdout.flush()
+
+    with open(args.output, 'w') as f:
+        json.dump(dict(commit=git_commit(), config=args.config, sim_time=args.sim_time, runs=results), f, indent=1)
+    print('wrote %s' % args.output)
+
+    if args.baseline:
+        slower = compare(results, json.load(open(args.baseline)), args.threshold)
+        if slower:
+            print('%d runs slower than the baseline by more than %.0f%%' % (len(slower), 100 * args.threshold))
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Reader for the binary columnar per-packet results written by the OLT (columnarOutput).
+
+As a library:
+    from colreader import read_columns, read_dataframe
+    cols = read_columns('results/General-0.col')      # {name: numpy array}
+    df = read_dataframe('results/General-0.col')      # pandas DataFrame, if pandas is installed
+As a script it prints the row count and per-class latency percentiles of one or more files.
+
+usage: colreader.py FILE [FILE ...]
+"""
+import struct
+import sys
+import zlib
+
+import numpy as np
+
+DTYPES = {'d': '<f8', 'f': '<f4', 'i': '<i4', 'b': 'u1'}
+CLASSES = ['xr', 'hmd', 'ctrl', 'hptc', 'bkg']          # same order as the OLT ci_class_names
+
+
+def read_columns(path):
+    """returns {column name: numpy array}, blocks are decoded without any text parsing"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'FTTRCOL1':
+        raise ValueError('%s is not a columnar result file' % path)
+    (ncols,) = struct.unpack_from('<I', data, 8)
+    pos = 12
+    names, types = [], []
+    for _ in range(ncols):
+        names.append(data[pos:pos + 24].split(b'\0', 1)[0].decode())
+        types.append(chr(data[pos + 24]))
+        pos += 25
+
+    chunks = [[] for _ in range(ncols)]
+    while pos + 4 <= len(data):
+        (nrows,) = struct.unpack_from('<I', data, pos)
+        pos += 4
+        for c in range(ncols):
+            codec, nbytes = struct.unpack_from('<II', data, pos)
+            pos += 8
+            raw = data[pos:pos + nbytes]
+            pos += nbytes
+            if codec == 1:
+                raw = zlib.decompress(raw)
+            arr = np.frombuffer(raw, dtype=DTYPES[types[c]])
+            if len(arr) != nrows:
+                raise ValueError('%s: truncated block in column %s' % (path, names[c]))
+            chunks[c].append(arr)
+    return {n: (np.concatenate(ch) if ch else np.empty(0, DTYPES[t])) for n, t, ch in zip(names, types, chunks)}
+
+
+def read_dataframe(path):
+    import pandas as pd
+    return pd.DataFrame(read_columns(path))
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+    for path in sys.argv[1:]:
+        cols = read_columns(path)
+        print('%s: %d rows' % (path, len(cols['time'])))
+        for k, name in enumerate(CLASSES):
+            lat = cols['latency'][cols['class'] == k]
+            if len(lat):
+                p50, p99 = np.percentile(lat, [50, 99])
+                print('  %-5s %9d packets  mean %.3e  p50 %.3e  p99 %.3e s' % (name, len(lat), lat.mean(), p50, p99))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+"""Generate the partition-id assignment for a parallel run of FTTR_50G_10GPON_v2.
+
+Every ONU subtree (ONU, MFU, internal splitter, SFUs, WAPs and the devices behind them) is
+kept in one partition; consecutive subtrees are grouped so that every partition gets the same
+number of ONUs. The OLT and the external splitter stay in partition 0. The only links that
+cross partitions are the 50G-PON drop fibres (FTTH_Channel), whose propagation delay is the
+lookahead of the null message protocol.
+
+usage: gen_partitions.py --onus 16 --sfus 8 --partitions 4 [-o parsim_partitions.ini]
+"""
+import argparse
+import sys
+
+
+def subtree_lines(first, last, sfus, xrs, pid):
+    """ini lines that put ONU subtrees first..last (inclusive) into partition pid"""
+    onu_rng = '[%d..%d]' % (first, last)
+    sfu_rng = '[%d..%d]' % (first * sfus, (last + 1) * sfus - 1)
+    xr_rng = '[%d..%d]' % (first * xrs, (last + 1) * xrs - 1)
+    lines = ['# ONUs %d..%d' % (first, last)]
+    for mod in ('onus', 'mfus', 'splitter_int'):
+        lines.append('*.%s%s.partition-id = %d' % (mod, onu_rng, pid))
+    for mod in ('sfus', 'waps', 'bkgs1', 'bkgs2', 'bkgs3'):
+        lines.append('*.%s%s.partition-id = %d' % (mod, sfu_rng, pid))
+    if xrs > 0:
+        for mod in ('xrs', 'hmds', 'controls', 'haptics'):
+            lines.append('*.%s%s.partition-id = %d' % (mod, xr_rng, pid))
+    return lines
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--onus', type=int, default=16, help='NumberOfONUs')
+    ap.add_argument('--sfus', type=int, default=8, help='NumberOfSFUs per ONU')
+    ap.add_argument('--partitions', type=int, default=4, help='number of partitions (processes)')
+    ap.add_argument('-o', '--output', default='-', help='output ini fragment (default: stdout)')
+    args = ap.parse_args()
+
+    if args.partitions < 1 or args.partitions > args.onus:
+        sys.exit('partitions must be between 1 and the number of ONUs')
+    xrs = args.sfus // 2
+
+    lines = ['# generated by tools/gen_partitions.py --onus %d --sfus %d --partitions %d'
+             % (args.onus, args.sfus, args.partitions),
+             'parsim-num-partitions = %d' % args.partitions,
+             '*.olt.partition-id = 0',
+             '*.splitter_ext.partition-id = 0']
+    first = 0
+    for p in range(args.partitions):
+        count = args.onus // args.partitions + (1 if p < args.onus % args.partitions else 0)
+        lines += subtree_lines(first, first + count - 1, args.sfus, xrs, p)
+        first += count
+
+    out = sys.stdout if args.output == '-' else open(args.output, 'w')
+    out.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Query the per-packet lifecycle trace written by the OLT (lifecycleTrace).
+
+Selects packets by flow (SourceId), class, SFU/ONU and an OLT arrival time window, and prints
+where each of them waited: the time spent on every hop between the eight timestamps. With
+--top only the packets with the largest end-to-end latency are shown, --csv writes the
+selection for further analysis.
+
+usage: lifecycle_query.py trace.lcy [--flow 123] [--class xr] [--from 0.5] [--to 0.6]
+                          [--min-latency 1e-3] [--top 20] [--csv out.csv]
+"""
+import argparse
+import struct
+import sys
+
+import numpy as np
+
+CLASSES = ['xr', 'hmd', 'ctrl', 'hptc', 'bkg']          # same order as the OLT ci_class_names
+TIMES = ['generation', 'wapArrival', 'wapDeparture', 'sfuArrival', 'sfuDeparture',
+         'onuArrival', 'onuDeparture', 'oltArrival']
+HOPS = ['wifi', 'wap', 'drop', 'sfu', 'int_pon', 'onu', 'ext_pon']     # between consecutive timestamps
+RECORD = np.dtype([(t, '<f8') for t in TIMES] +
+                  [('sourceId', '<i4'), ('onuId', '<i4'), ('sfuId', '<i4'), ('mfuId', '<i4'), ('bytes', '<i4'),
+                   ('cls', 'u1'), ('tcont', 'u1'), ('fragmentCount', '<u2')])
+
+
+def load(path):
+    """all records in the order they were written (oldest first, also for a wrapped ring)"""
+    with open(path, 'rb') as f:
+        header = f.read(64)
+    if header[:8] != b'FTTRLCY1':
+        raise SystemExit('%s is not a lifecycle trace' % path)
+    rec_size, ring, capacity, written = struct.unpack_from('<IIQQ', header, 8)
+    if rec_size != RECORD.itemsize:
+        raise SystemExit('record size %d, this tool expects %d' % (rec_size, RECORD.itemsize))
+    data = np.memmap(path, dtype=RECORD, mode='r', offset=64, shape=(capacity,))
+    if written <= capacity:
+        return np.array(data[:written])
+    head = written % capacity                            # ring wrapped: oldest record is at the write position
+    return np.concatenate([data[head:], data[:head]])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('trace')
+    ap.add_argument('--flow', type=int, action='append', help='SourceId, may be repeated')
+    ap.add_argument('--class', dest='cls', choices=CLASSES)
+    ap.add_argument('--sfu', type=int)
+    ap.add_argument('--onu', type=int)
+    ap.add_argument('--from', dest='t_from', type=float, help='OLT arrival time window start (s)')
+    ap.add_argument('--to', dest='t_to', type=float, help='OLT arrival time window end (s)')
+    ap.add_argument('--min-latency', type=float, default=0)
+    ap.add_argument('--top', type=int, default=0, help='only the N packets with the largest latency')
+    ap.add_argument('--csv', default=None)
+    args = ap.parse_args()
+
+    rec = load(args.trace)
+    latency = rec['oltArrival'] - rec['generation']
+    sel = latency >= args.min_latency
+    if args.flow:
+        sel &= np.isin(rec['sourceId'], args.flow)
+    if args.cls:
+        sel &= rec['cls'] == CLASSES.index(args.cls)
+    if args.sfu is not None:
+        sel &= rec['sfuId'] == args.sfu
+    if args.onu is not None:
+        sel &= rec['onuId'] == args.onu
+    if args.t_from is not None:
+        sel &= rec['oltArrival'] >= args.t_from
+    if args.t_to is not None:
+        sel &= rec['oltArrival'] <= args.t_to
+    idx = np.nonzero(sel)[0]
+    if args.top:
+        idx = idx[np.argsort(latency[idx])[::-1][:args.top]]
+
+    hops = np.stack([rec[TIMES[i + 1]] - rec[TIMES[i]] for i in range(len(HOPS))], axis=1)
+    print('%d of %d records selected' % (len(idx), len(rec)))
+    if len(idx):
+        print('%12s %7s %5s %5s %5s %11s ' % ('olt_arrival', 'flow', 'class', 'onu', 'sfu', 'latency[us]')
+              + ' '.join('%9s' % h for h in HOPS))
+        for i in idx[:1000]:
+            r = rec[i]
+            print('%12.6f %7d %5s %5d %5d %11.2f ' % (r['oltArrival'], r['sourceId'], CLASSES[r['cls']], r['onuId'],
+                  r['sfuId'], 1e6 * latency[i]) + ' '.join('%9.2f' % (1e6 * h) for h in hops[i]))
+        if len(idx) > 1000:
+            print('... %d more, use --csv for all' % (len(idx) - 1000))
+        mean = hops[idx].mean(axis=0)
+        print('mean wait per hop [us]: ' + ', '.join('%s %.2f' % (h, 1e6 * m) for h, m in zip(HOPS, mean)))
+
+    if args.csv:
+        with open(args.csv, 'w') as f:
+            f.write(','.join(TIMES + ['sourceId', 'onuId', 'sfuId', 'mfuId', 'bytes', 'class', 'tcont', 'fragmentCount']) + '\n')
+            for i in idx:
+                r = rec[i]
+                f.write(','.join(['%.12g' % r[t] for t in TIMES] + [str(r[k]) for k in
+                        ('sourceId', 'onuId', 'sfuId', 'mfuId', 'bytes')] + [CLASSES[r['cls']], str(r['tcont']),
+                        str(r['fragmentCount'])]) + '\n')
+    sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Run every run of an omnetpp.ini config concurrently and merge the scalar results.
+
+The iteration space (loads x seeds x topology sizes of [Config Sweep]) is expanded by the
+simulation itself (-q numruns). Runs are then pulled from a work queue by one worker per core.
+A run that crashes or leaves no scalar file is retried, and runs that already completed in an
+earlier invocation are skipped, so an interrupted sweep can simply be started again.
+All scalars and statistic fields are merged into one CSV with one row per value.
+
+usage: run_sweep.py [-c Sweep] [-j 32] [--exe ./fttr] [--out results/sweep]
+"""
+import argparse
+import concurrent.futures
+import csv
+import json
+import os
+import subprocess
+import sys
+import time
+
+
+def query_numruns(exe, ini, config):
+    """number of runs in the config, as expanded by the simulation"""
+    out = subprocess.run([exe, '-u', 'Cmdenv', '-f', ini, '-c', config, '-q', 'numruns'],
+                         capture_output=True, text=True, check=True).stdout
+    return int(out.strip().split()[-1])
+
+
+def sca_path(outdir, run):
+    return os.path.join(outdir, 'run%04d.sca' % run)
+
+
+def run_once(exe, ini, config, run, outdir, extra):
+    """run one simulation, returns (exit code, seconds)"""
+    cmd = [exe, '-u', 'Cmdenv', '-f', ini, '-c', config, '-r', str(run),
+           '--cmdenv-express-mode=true', '--cmdenv-status-frequency=60s',
+           '--result-dir=' + outdir,
+           '--output-scalar-file=' + sca_path(outdir, run),
+           '--output-vector-file=' + os.path.join(outdir, 'run%04d.vec' % run)] + extra
+    start = time.time()
+    with open(os.path.join(outdir, 'run%04d.log' % run), 'w') as log:
+        rc = subprocess.call(cmd, stdout=log, stderr=subprocess.STDOUT)
+    return rc, time.time() - start
+
+
+def parse_sca(path):
+    """yields (attrs, module, name, value) for every scalar and statistic field in a .sca file"""
+    attrs = {}
+    stat = None
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if not parts:
+                continue
+            if parts[0] == 'run':
+                attrs = {'runId': parts[1]}
+            elif parts[0] in ('attr', 'itervar') and len(parts) >= 3:
+                attrs[parts[1]] = ' '.join(parts[2:]).strip('"')
+            elif parts[0] == 'scalar' and len(parts) >= 4:
+                yield attrs, parts[1], parts[2].strip('"'), parts[3]
+                stat = None
+            elif parts[0] == 'statistic' and len(parts) >= 3:
+                stat = (parts[1], parts[2].strip('"'))
+            elif parts[0] == 'field' and stat is not None and len(parts) >= 3:
+                yield attrs, stat[0], stat[1] + ':' + parts[1], parts[2]
+
+
+def merge(scas, summary, itervars):
+    """write all scalars of the given .sca files into one CSV"""
+    with open(summary, 'w', newline='') as f:
+        w = csv.writer(f)
+        w.writerow(['run', 'repetition'] + itervars + ['module', 'name', 'value'])
+        for run, path in scas:
+            for attrs, module, name, value in parse_sca(path):
+                w.writerow([run, attrs.get('repetition', '')] + [attrs.get(v, '') for v in itervars]
+                           + [module, name, value])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('-c', '--config', default='Sweep')
+    ap.add_argument('-f', '--ini', default='omnetpp.ini')
+    ap.add_argument('-j', '--jobs', type=int, default=os.cpu_count())
+    ap.add_argument('--exe', default='./fttr', help='simulation executable')
+    ap.add_argument('--out', default='results/sweep', help='directory for per-run results')
+    ap.add_argument('--runs', default=None, help='run numbers to execute, e.g. 0-9,15 (default: all)')
+    ap.add_argument('--retries', type=int, default=2, help='extra attempts for a crashed run')
+    ap.add_argument('--vectors', action='store_true', help='keep output vectors (off by default)')
+    ap.add_argument('--itervars', default='load,seed,onus,sfus', help='iteration variables for the summary columns')
+    ap.add_argument('--summary', default=None, help='merged CSV (default: <out>/summary.csv)')
+    args = ap.parse_args()
+
+    os.makedirs(args.out, exist_ok=True)
+    state_file = os.path.join(args.out, 'state.json')
+    state = json.load(open(state_file)) if os.path.exists(state_file) else {}
+
+    if args.runs:
+        runs = []
+        for part in args.runs.split(','):
+            a, _, b = part.partition('-')
+            runs += range(int(a), int(b or a) + 1)
+    else:
+        runs = list(range(query_numruns(args.exe, args.ini, args.config)))
+    extra = [] if args.vectors else ['--**.vector-recording=false']
+
+    todo = [r for r in runs if not (state.get(str(r)) == 'done' and os.path.exists(sca_path(args.out, r)))]
+    print('%d runs, %d already done, %d workers' % (len(runs), len(runs) - len(todo), args.jobs))
+
+    def work(run):
+        for attempt in range(args.retries + 1):
+            rc, secs = run_once(args.exe, args.ini, args.config, run, args.out, extra)
+            if rc == 0 and os.path.exists(sca_path(args.out, run)):
+                return run, 'done', secs, attempt
+        return run, 'failed', secs, attempt
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        for fut in concurrent.futures.as_completed([pool.submit(work, r) for r in todo]):
+            run, status, secs, attempt = fut.result()
+            state[str(run)] = status
+            json.dump(state, open(state_file, 'w'), indent=1)
+            print('run %4d %-6s %7.1fs%s' % (run, status, secs, ' (%d retries)' % attempt if attempt else ''))
+
+    failed = [r for r in runs if state.get(str(r)) != 'done']
+    scas = [(r, sca_path(args.out, r)) for r in runs if state.get(str(r)) == 'done']
+    summary = args.summary or os.path.join(args.out, 'summary.csv')
+    merge(scas, summary, args.itervars.split(','))
+    print('merged %d runs into %s' % (len(scas), summary))
+    if failed:
+        print('failed runs (see run*.log): ' + ','.join(map(str, failed)))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Scaling benchmark: wall time per simulated second, events/s and peak RSS versus topology size.
+
+Runs every run of [Config Scale] one after the other (so timings and memory do not disturb each
+other) and prints one line per topology. Super-linear growth of wall time per simulated second
+or of memory per ONU shows up directly in the last columns.
+
+usage: scale_bench.py [--exe ./fttr] [-c Scale] [--sim-time 0.05s] [-o scale.csv]
+"""
+import argparse
+import csv
+import os
+import re
+import subprocess
+import sys
+import time
+
+from run_sweep import query_numruns
+
+
+def query_itervars(exe, ini, config):
+    """{run: {itervar: value}} as printed by -q runs"""
+    out = subprocess.run([exe, '-u', 'Cmdenv', '-f', ini, '-c', config, '-q', 'runs'],
+                         capture_output=True, text=True, check=True).stdout
+    runs = {}
+    for line in out.splitlines():
+        m = re.match(r'\s*Run (\d+):\s*(.*)', line)
+        if m:
+            runs[int(m.group(1))] = dict(re.findall(r'\$(\w+)=([^,\s]+)', m.group(2)))
+    return runs
+
+
+def bench_run(exe, ini, config, run, sim_time):
+    """returns (wall seconds, events, peak RSS in MB, exit code)"""
+    cmd = [exe, '-u', 'Cmdenv', '-f', ini, '-c', config, '-r', str(run),
+           '--cmdenv-express-mode=true', '--sim-time-limit=' + sim_time,
+           '--**.vector-recording=false', '--**.scalar-recording=false']
+    start = time.time()
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    out = proc.stdout.read()
+    _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    events = [int(e) for e in re.findall(r'event #(\d+)', out)]
+    rss_mb = usage.ru_maxrss / 1024.0                  # ru_maxrss is in kB on Linux
+    return wall, (max(events) if events else 0), rss_mb, os.waitstatus_to_exitcode(status)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('--exe', default='./fttr')
+    ap.add_argument('-f', '--ini', default='omnetpp.ini')
+    ap.add_argument('-c', '--config', default='Scale')
+    ap.add_argument('--sim-time', default='0.05s', help='simulated time per run')
+    ap.add_argument('-o', '--output', default=None, help='optional CSV output')
+    args = ap.parse_args()
+
+    itervars = query_itervars(args.exe, args.ini, args.config)
+    sim_secs = float(args.sim_time.rstrip('s'))
+    rows = []
+    print('%6s %5s %10s %14s %12s %10s %12s' % ('onus', 'sfus', 'wall[s]', 'wall/simsec', 'events/s', 'RSS[MB]', 'MB/ONU'))
+    for run in range(query_numruns(args.exe, args.ini, args.config)):
+        wall, events, rss, rc = bench_run(args.exe, args.ini, args.config, run, args.sim_time)
+        v = itervars.get(run, {})
+        onus, sfus = int(v.get('onus', 0)), int(v.get('sfus', 0))
+        row = dict(onus=onus, sfus=sfus, wall=wall, wall_per_simsec=wall / sim_secs,
+                   events=events, events_per_s=events / wall if wall > 0 else 0, rss_mb=rss, exit=rc)
+        rows.append(row)
+        print('%6d %5d %10.2f %14.1f %12.0f %10.1f %12.2f%s' % (onus, sfus, wall, row['wall_per_simsec'],
+              row['events_per_s'], rss, rss / onus if onus else 0, '' if rc == 0 else '  (exit %d)' % rc))
+        sys.stdout.flush()
+
+    if args.output:
+        with open(args.output, 'w', newline='') as f:
+            w = csv.DictWriter(f, fieldnames=list(rows[0].keys()) if rows else ['onus'])
+            w.writeheader()
+            w.writerows(rows)
+
+
+if __name__ == '__main__':
+    main()
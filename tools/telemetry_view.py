@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""Live viewer for the DBA telemetry segment of a running simulation (OLT/MFU telemetry parameter).
+
+Maps the POSIX shared-memory segment read-only and redraws every --interval seconds: simulation
+progress and speed, running p50/p99 latency per traffic class, and the ONUs (and SFUs behind
+their MFUs) with the largest reported backlog and grants. Attaching and detaching never affects
+the simulation. --stop asks the OLT to end the run at its next telemetry update, so a bad
+configuration can be aborted with its results so far written.
+
+usage: telemetry_view.py /fttr-0 [--interval 1] [--top 10] [--once] [--stop]
+"""
+import argparse
+import mmap
+import os
+import struct
+import sys
+import time
+
+CLASSES = ['xr', 'hmd', 'ctrl', 'hptc', 'bkg']
+FIELDS = 4                                              # bufTC2, bufTC3, grantTC2, grantTC3
+HEADER = 64
+
+
+def block_size(entries):
+    return 8 + 8 * (3 + 3 * len(CLASSES) + FIELDS * entries)
+
+
+def read_block(mm, offset, entries):
+    """seqlock read: retry until the block did not change while it was copied"""
+    n = 3 + 3 * len(CLASSES) + FIELDS * entries
+    for _ in range(1000):
+        (seq1,) = struct.unpack_from('<Q', mm, offset)
+        if seq1 % 2:
+            time.sleep(0)
+            continue
+        values = struct.unpack_from('<%dd' % n, mm, offset + 8)
+        (seq2,) = struct.unpack_from('<Q', mm, offset)
+        if seq1 == seq2:
+            return seq1, values
+    return None, None
+
+
+def open_segment(name, writable):
+    path = '/dev/shm/' + name.lstrip('/')
+    fd = os.open(path, os.O_RDWR if writable else os.O_RDONLY)
+    try:
+        size = os.fstat(fd).st_size
+        return mmap.mmap(fd, size, access=mmap.ACCESS_WRITE if writable else mmap.ACCESS_READ)
+    finally:
+        os.close(fd)
+
+
+def entries(values):
+    base = 3 + 3 * len(CLASSES)
+    rest = values[base:]
+    return [rest[i:i + FIELDS] for i in range(0, len(rest), FIELDS)]
+
+
+def render(mm, top, prev):
+    if mm[:8] != b'FTTRTEL1':
+        return 'not a telemetry segment', prev
+    onus, sfus, stop, pid = struct.unpack_from('<IIII', mm, 8)
+    seq, olt = read_block(mm, HEADER, onus)
+    if seq is None or seq == 0:
+        return 'pid %d: waiting for the first update' % pid, prev
+    now = time.time()
+    sim_t, events = olt[0], olt[1]
+    speed = ''
+    if prev:
+        dt = now - prev[0]
+        if dt > 0:
+            speed = '  %.3g sim s/s  %.3g events/s' % ((sim_t - prev[1]) / dt, (events - prev[2]) / dt)
+    lines = ['pid %d  %dx%d  t = %.6f s  events %.0f%s%s' % (pid, onus, sfus, sim_t, events, speed,
+             '  (stop requested)' if stop else ''),
+             'downstream queue %.0f B' % olt[2], '',
+             '%-5s %12s %12s %10s' % ('class', 'p50 [us]', 'p99 [us]', 'samples')]
+    for c, name in enumerate(CLASSES):
+        p50, p99, n = olt[3 + 3 * c: 6 + 3 * c]
+        if n:
+            lines.append('%-5s %12.2f %12.2f %10.0f' % (name, 1e6 * p50, 1e6 * p99, n))
+
+    onu_rows = entries(olt)
+    order = sorted(range(onus), key=lambda i: -(onu_rows[i][0] + onu_rows[i][1]))[:top]
+    lines += ['', '%5s %12s %12s %12s %12s   %s' % ('onu', 'buf TC2', 'buf TC3', 'grant TC2', 'grant TC3',
+                                                     'worst SFU behind its MFU (backlog TC2+TC3)')]
+    for i in order:
+        worst = ''
+        _, mfu = read_block(mm, HEADER + block_size(onus) + i * block_size(sfus), sfus)
+        if mfu:
+            sfu_rows = entries(mfu)
+            k = max(range(sfus), key=lambda j: sfu_rows[j][0] + sfu_rows[j][1])
+            worst = 'sfu %d: %.0f B' % (i * sfus + k, sfu_rows[k][0] + sfu_rows[k][1])
+        b2, b3, g2, g3 = onu_rows[i]
+        lines.append('%5d %12.0f %12.0f %12.0f %12.0f   %s' % (i, b2, b3, g2, g3, worst))
+    return '\n'.join(lines), (now, sim_t, events)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('segment', help='value of the telemetry parameter, e.g. /fttr-0')
+    ap.add_argument('--interval', type=float, default=1.0)
+    ap.add_argument('--top', type=int, default=10, help='ONUs with the largest backlog to show')
+    ap.add_argument('--once', action='store_true')
+    ap.add_argument('--stop', action='store_true', help='ask the simulation to end the run')
+    args = ap.parse_args()
+
+    if args.stop:
+        mm = open_segment(args.segment, True)
+        struct.pack_into('<I', mm, 16, 1)
+        print('stop requested')
+        return
+
+    mm = open_segment(args.segment, False)
+    prev = None
+    try:
+        while True:
+            text, prev = render(mm, args.top, prev)
+            if args.once:
+                print(text)
+                return
+            sys.stdout.write('\033[H\033[J' + text + '\n')
+            sys.stdout.flush()
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
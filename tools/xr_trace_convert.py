@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Convert a recorded XR encoder trace (CSV/whitespace text) into the binary trace replayed by XR_Device.
+
+Input: one frame per line with timestamp, frame size in bytes and frame type (I/P, or 1/0),
+in the column order given by --columns. Lines starting with '#' and a non-numeric header are
+skipped. Timestamps are converted to seconds with --time-unit and made relative to the first frame.
+
+Output ("FTTRXRT1" | uint64 frames | frames x {float64 time, uint32 size, uint8 type, 3 pad}) is
+what xr_trace.h maps; set it with **.xrs[*].traceFile = "trace.xrt".
+
+usage: xr_trace_convert.py trace.csv trace.xrt [--columns time,size,type] [--time-unit ms]
+"""
+import argparse
+import re
+import struct
+
+UNITS = {'s': 1.0, 'ms': 1e-3, 'us': 1e-6, 'ns': 1e-9}
+
+
+def parse(path, columns, scale):
+    t_idx, s_idx = columns.index('time'), columns.index('size')
+    y_idx = columns.index('type') if 'type' in columns else None
+    frames = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            parts = re.split(r'[,;\s]+', line)
+            try:
+                t = float(parts[t_idx]) * scale
+                size = int(float(parts[s_idx]))
+            except (ValueError, IndexError):
+                continue                                    # header or malformed line
+            kind = parts[y_idx].upper() if y_idx is not None and y_idx < len(parts) else 'P'
+            frames.append((t, size, 1 if kind in ('I', '1', 'IDR', 'KEY') else 0))
+    frames.sort(key=lambda fr: fr[0])
+    return frames
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    ap.add_argument('input')
+    ap.add_argument('output')
+    ap.add_argument('--columns', default='time,size,type', help='order of the input columns')
+    ap.add_argument('--time-unit', default='s', choices=sorted(UNITS))
+    args = ap.parse_args()
+
+    frames = parse(args.input, args.columns.split(','), UNITS[args.time_unit])
+    if not frames:
+        raise SystemExit('no frames found in ' + args.input)
+    t0 = frames[0][0]
+    with open(args.output, 'wb') as out:
+        out.write(b'FTTRXRT1')
+        out.write(struct.pack('<Q', len(frames)))
+        for t, size, kind in frames:
+            out.write(struct.pack('<dIB3x', t - t0, size, kind))
+    duration = frames[-1][0] - t0
+    total = sum(fr[1] for fr in frames)
+    print('%d frames (%d I-frames), %.1f s, %.1f fps, %.1f Mbps' % (len(frames), sum(fr[2] for fr in frames),
+          duration, (len(frames) - 1) / duration if duration > 0 else 0, 8e-6 * total / duration if duration > 0 else 0))
+
+
+if __name__ == '__main__':
+    main()
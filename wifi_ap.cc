@@ -12,6 +12,7 @@
 #include <algorithm> // Required for std::sort
 
 #include "sim_params.h"
+#include "profiling.h"
 #include "ethPacket_m.h"
 #include "ping_m.h"
 #include "gtc_header_m.h"
@@ -22,10 +23,46 @@ using namespace omnetpp;
 class WiFi_AP : public cSimpleModule
 {
     private:
+        long numEvents = 0;                     // handled events
         //cQueue wap_queue;
+        vector<const char *> dl_gate = {"SrcXr_out", "SrcHmd_out", "SrcBkg1_out", "SrcBkg2_out", "SrcBkg3_out"};
+        vector<cQueue *> dl_queue;          // per-device queues for downstream packets while the wireless link is busy
+
+        // shared-medium MAC: every device and the AP itself (downstream) are stations with one queue per EDCA
+        // access category, one A-MPDU is on the air at a time; the wireless channels then only carry the delay
+        int mac_mode;                           // MAC_NONE, MAC_EDCA or MAC_ANALYTICAL
+        double phy_rate;                        // PHY datarate of the A-MPDU payload (bps)
+        double phy_overhead;                    // preamble and PHY header of every PPDU (s)
+        double ack_time;                        // SIFS + BlockAck after every PPDU (s)
+        int max_ampdu_frames;
+        int retry_limit;
+        vector<const char *> src_gate = {"SrcXr_in", "SrcHmd_in", "SrcCtr_in", "SrcHpt_in", "SrcBkg1_in", "SrcBkg2_in", "SrcBkg3_in"};
+        vector<int> src_gate_id;                // station of an upstream packet, the AP is station src_gate.size()
+        int stations;
+        vector<cQueue *> mac_queue;             // [station*num_acs + ac], MAC_EDCA
+        vector<int> mac_cw;
+        vector<int> mac_backoff;                // remaining backoff slots, -1 = none drawn
+        vector<int> mac_retries;
+        vector<simtime_t> mac_count_from;       // countdown start (medium idle and queue non-empty), -1 = frozen
+        vector<int> mac_tx;                     // queues on the air, more than one = collision
+        vector<int> mac_tx_frames;
+        cMessage *mac_access = nullptr;         // next backoff expiry
+        cMessage *mac_tx_end = nullptr;
+        vector<simtime_t> mac_burst_start;      // MAC_ANALYTICAL: last A-MPDU of every queue
+        vector<simtime_t> mac_burst_end;
+        vector<int> mac_burst_frames;
+        vector<double> mac_burst_air;
+        simtime_t mac_medium_free = 0;
+        long mac_ampdus = 0;
+        long mac_frames = 0;
+        long mac_collisions = 0;
+        long mac_drops = 0;
+        double mac_busy = 0;                    // airtime of all PPDUs, collisions included
+        vector<double> mac_delay_sum;           // per access category, arrival at the AP to end of the A-MPDU
+        vector<long> mac_delay_count;
 
     public:
-        //virtual ~WiFi_AP();
+        virtual ~WiFi_AP();
 
     protected:
         double ber;
@@ -36,11 +73,59 @@ class WiFi_AP : public cSimpleModule
         // The following redefined virtual function holds the algorithm.
         virtual void initialize() override;
         virtual void handleMessage(cMessage *msg) override;
+        virtual void finish() override;
+        virtual void sendDownstream(ethPacket *pkt, int k);
+        virtual int dlDevice(ethPacket *pkt);
+        virtual int accessCategory(ethPacket *pkt);
+        virtual double frameAirtime(ethPacket *pkt);
+        virtual void macArrival(ethPacket *pkt, int st);
+        virtual void macPostBackoff(int q, simtime_t now);
+        virtual void macAnalytical(ethPacket *pkt, int st, int ac);
+        virtual void macScheduleAccess();
+        virtual void macAccess();
+        virtual void macTxEnd();
+        virtual void macDeliver(ethPacket *pkt, int st, int ac);
         //virtual ponPacket *generateGrantPacket();
 };
 
 Define_Module(WiFi_AP);
 
+enum { MAC_NONE, MAC_EDCA, MAC_ANALYTICAL };
+
+// EDCA parameter set of an access category (802.11 defaults for a non-AP station), the TXOP limits
+// bound the airtime of one A-MPDU; BK and BE may use one PPDU of the maximum duration
+struct EdcaParams
+{
+    int aifsn;
+    int cwmin;
+    int cwmax;
+    double txop;
+};
+static const int num_acs = 4;
+static const EdcaParams edca[num_acs] = {{7, 15, 1023, 5.484e-3}, {3, 15, 1023, 5.484e-3}, {2, 7, 15, 4.096e-3}, {2, 3, 7, 2.080e-3}};
+static const char *ac_names[num_acs] = {"bk", "be", "vi", "vo"};
+static const double slot_time = 9e-6;
+static const double sifs = 16e-6;
+static const int mpdu_overhead = 40;                // MAC header, FCS and A-MPDU delimiter per frame (bytes)
+
+WiFi_AP::~WiFi_AP()
+{
+    for(auto q : dl_queue) {
+        while (!q->isEmpty()) {
+            delete q->pop();
+        }
+        delete q;
+    }
+    for(auto q : mac_queue) {
+        while (!q->isEmpty()) {
+            delete q->pop();
+        }
+        delete q;
+    }
+    cancelAndDelete(mac_access);
+    cancelAndDelete(mac_tx_end);
+}
+
 void WiFi_AP::initialize()
 {
     //olt_queue.setName("olt_queue");
@@ -53,11 +138,75 @@ void WiFi_AP::initialize()
     gate("SrcBkg1_in")->setDeliverImmediately(true);
     gate("SrcBkg2_in")->setDeliverImmediately(true);
     gate("SrcBkg3_in")->setDeliverImmediately(true);
+
+    for(size_t k = 0; k < dl_gate.size(); k++) {
+        dl_queue.push_back(new cQueue("dl_queue"));
+    }
+
+    const char *mac = par("mac").stringValue();
+    if(strcmp(mac, "none") == 0)
+        mac_mode = MAC_NONE;
+    else if(strcmp(mac, "edca") == 0)
+        mac_mode = MAC_EDCA;
+    else if(strcmp(mac, "analytical") == 0)
+        mac_mode = MAC_ANALYTICAL;
+    else
+        throw cRuntimeError("unknown mac '%s' (none, edca, analytical)", mac);
+    if(mac_mode == MAC_NONE)
+        return;
+
+    phy_rate = par("phyRate").doubleValueInUnit("bps");
+    phy_overhead = par("phyOverhead").doubleValueInUnit("s");
+    ack_time = par("ackTime").doubleValueInUnit("s");
+    max_ampdu_frames = par("maxAmpduFrames");
+    retry_limit = par("retryLimit");
+
+    // the MAC accounts for the airtime, the wireless channels have no datarate in this mode (Wireless_Channel shared)
+    for(auto name : src_gate) {
+        src_gate_id.push_back(gate(name)->getId());
+    }
+    stations = src_gate.size() + 1;
+    mac_cw.resize(stations*num_acs);
+    for(int i = 0; i < stations*num_acs; i++) {
+        mac_queue.push_back(new cQueue("mac_queue"));
+        mac_cw[i] = edca[i % num_acs].cwmin;
+    }
+    mac_backoff.resize(stations*num_acs, -1);
+    mac_retries.resize(stations*num_acs, 0);
+    mac_count_from.resize(stations*num_acs, -1);
+    mac_burst_start.resize(stations*num_acs, -1);
+    mac_burst_end.resize(stations*num_acs, -1);
+    mac_burst_frames.resize(stations*num_acs, 0);
+    mac_burst_air.resize(stations*num_acs, 0);
+    mac_delay_sum.resize(num_acs, 0);
+    mac_delay_count.resize(num_acs, 0);
+    mac_access = new cMessage("mac_access");
+    mac_tx_end = new cMessage("mac_tx_end");
 }
 
 void WiFi_AP::handleMessage(cMessage *msg)
 {
+    numEvents++;
+    FTTR_PROFILE_HANDLER(msg);
     if(msg->isPacket() == true) {
+        if(mac_mode != MAC_NONE) {
+            ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+            if(msg->arrivedOn("Sfu_in")) {
+                int k = dlDevice(pkt);
+                if(!gate(dl_gate[k])->isConnected()) {          // device is not behind this WiFi AP
+                    EV << "[wap" << getIndex() << "] no device on " << dl_gate[k] << ", dropping " << pkt->getName() << endl;
+                    delete pkt;
+                    return;
+                }
+                macArrival(pkt, stations - 1);
+            }
+            else {
+                int st = std::find(src_gate_id.begin(), src_gate_id.end(), msg->getArrivalGateId()) - src_gate_id.begin();
+                macArrival(pkt, st);
+            }
+            return;
+        }
+
         if(strcmp(msg->getName(),"bkg_data") == 0) {        // updating buffer size after receiving requests from ONUs
             ethPacket *pkt = check_and_cast<ethPacket *>(msg);
 
@@ -103,13 +252,326 @@ void WiFi_AP::handleMessage(cMessage *msg)
 
             //delete pkt;
         }
+        else if(strcmp(msg->getName(),"xr_dl_data") == 0) {        // downstream packets are delivered to the addressed device
+            sendDownstream(check_and_cast<ethPacket *>(msg), 0);
+        }
+        else if(strcmp(msg->getName(),"hmd_dl_data") == 0) {
+            sendDownstream(check_and_cast<ethPacket *>(msg), 1);
+        }
+        else if(strcmp(msg->getName(),"bkg_dl_data") == 0) {
+            ethPacket *pkt = check_and_cast<ethPacket *>(msg);
+            sendDownstream(pkt, 1 + pkt->getDeviceId());            // background devices 1..3
+        }
     }
     else {
-        EV << "[wap" << getIndex() << "] Some unknown cMessage has arrived at = " << simTime() << endl;
+        if(strcmp(msg->getName(),"DL_Tx_Delay") == 0) {
+            int k = msg->getKind();
+            cChannel *dev_ch = gate(dl_gate[k])->getTransmissionChannel();
+            if(dev_ch->isBusy() == true) {
+                scheduleAt(dev_ch->getTransmissionFinishTime(), msg);
+            }
+            else {
+                send((cPacket *)dl_queue[k]->pop(), dl_gate[k]);
+                if(!dl_queue[k]->isEmpty()) {
+                    scheduleAt(dev_ch->getTransmissionFinishTime(), msg);
+                }
+                else {
+                    delete msg;
+                }
+            }
+        }
+        else if(msg == mac_access) {
+            macAccess();
+        }
+        else if(msg == mac_tx_end) {
+            macTxEnd();
+        }
+        else {
+            EV << "[wap" << getIndex() << "] Some unknown cMessage has arrived at = " << simTime() << endl;
+        }
+    }
+}
+
+void WiFi_AP::sendDownstream(ethPacket *pkt, int k)
+{
+    if(!gate(dl_gate[k])->isConnected()) {          // device is not behind this WiFi AP
+        EV << "[wap" << getIndex() << "] no device on " << dl_gate[k] << ", dropping " << pkt->getName() << endl;
+        delete pkt;
+        return;
+    }
+    cChannel *dev_ch = gate(dl_gate[k])->getTransmissionChannel();
+    if((dev_ch->isBusy() == false)&&(dl_queue[k]->isEmpty())) {
+        send(pkt, dl_gate[k]);
+    }
+    else {
+        dl_queue[k]->insert(pkt);
+        if(dl_queue[k]->getLength() == 1) {             // first waiting packet, the link needs a timer
+            cMessage *dl_tx = new cMessage("DL_Tx_Delay");
+            dl_tx->setKind(k);
+            scheduleAt(dev_ch->getTransmissionFinishTime(), dl_tx);
+        }
+    }
+}
+
+int WiFi_AP::dlDevice(ethPacket *pkt)
+{
+    if(strcmp(pkt->getName(),"xr_dl_data") == 0)
+        return 0;
+    if(strcmp(pkt->getName(),"hmd_dl_data") == 0)
+        return 1;
+    return 1 + pkt->getDeviceId();                          // background devices 1..3
+}
+
+int WiFi_AP::accessCategory(ethPacket *pkt)
+{
+    if((strcmp(pkt->getName(),"control_data") == 0)||(strcmp(pkt->getName(),"haptic_data") == 0))
+        return 3;                                           // AC_VO
+    if((strncmp(pkt->getName(),"xr_",3) == 0)||(strncmp(pkt->getName(),"hmd_",4) == 0))
+        return 2;                                           // AC_VI
+    return 1;                                               // AC_BE
+}
+
+double WiFi_AP::frameAirtime(ethPacket *pkt)
+{
+    return (pkt->getByteLength() + mpdu_overhead)*8/phy_rate;
+}
+
+void WiFi_AP::macArrival(ethPacket *pkt, int st)
+{
+    int ac = accessCategory(pkt);
+    if(mac_mode == MAC_ANALYTICAL) {
+        macAnalytical(pkt, st, ac);
+        return;
+    }
+    int q = st*num_acs + ac;
+    mac_queue[q]->insert(pkt);
+    if(mac_queue[q]->getLength() == 1) {
+        macPostBackoff(q, simTime());
+        if(mac_backoff[q] < 0)
+            mac_backoff[q] = intuniform(0, mac_cw[q], rng_wifi);
+        if(!mac_tx_end->isScheduled())
+            mac_count_from[q] = simTime();          // medium idle: AIFS starts now, otherwise at the end of the current PPDU
     }
+    macScheduleAccess();
 }
 
+// MAC_ANALYTICAL: the A-MPDU of a packet is placed on the medium when it arrives, with a backoff drawn
+// for the number of queues contending at that moment (collision probability of a station that transmits
+// in a slot with 2/(CWmin+1), as in the non-saturated Bianchi model), so no event is added per packet
+void WiFi_AP::macAnalytical(ethPacket *pkt, int st, int ac)
+{
+    simtime_t now = simTime();
+    int q = st*num_acs + ac;
+    double air = frameAirtime(pkt);
+    if((mac_burst_start[q] > now)&&(mac_burst_end[q] == mac_medium_free)&&(mac_burst_frames[q] < max_ampdu_frames)
+            &&(mac_burst_air[q] + air <= edca[ac].txop)) {
+        // the queue is still waiting for its TXOP and its A-MPDU is the last one on the medium: aggregated
+        mac_burst_end[q] += air;                    // frames aggregated before keep their earlier reception time
+        mac_burst_frames[q]++;
+        mac_burst_air[q] += air;
+        mac_medium_free = mac_burst_end[q];
+        mac_busy += air;
+        mac_frames++;
+        macDeliver(pkt, st, ac);
+        return;
+    }
+
+    int contenders = 0;
+    for(int j = 0; j < stations*num_acs; j++) {
+        if((j != q)&&(mac_burst_end[j] > now))
+            contenders++;
+    }
+    double p_coll = 1 - pow(1 - 2.0/(edca[ac].cwmin + 1), contenders);
+    double ppdu = phy_overhead + air + ack_time;
+    int cw = edca[ac].cwmin;
+    double access = sifs + edca[ac].aifsn*slot_time + intuniform(0, cw, rng_wifi)*slot_time;
+    int retries = 0;
+    while(uniform(0, 1, rng_wifi) < p_coll) {
+        mac_collisions++;
+        mac_busy += ppdu;
+        if(++retries > retry_limit)
+            break;
+        cw = std::min(2*cw + 1, edca[ac].cwmax);
+        access += ppdu + sifs + edca[ac].aifsn*slot_time + intuniform(0, cw, rng_wifi)*slot_time;
+    }
+    simtime_t start = std::max(now, mac_medium_free) + access;
+    if(retries > retry_limit) {
+        mac_medium_free = start;
+        mac_drops++;
+        delete pkt;
+        return;
+    }
+    mac_burst_start[q] = start;
+    mac_burst_end[q] = start + ppdu;
+    mac_burst_frames[q] = 1;
+    mac_burst_air[q] = air;
+    mac_medium_free = mac_burst_end[q];
+    mac_busy += ppdu;
+    mac_ampdus++;
+    mac_frames++;
+    macDeliver(pkt, st, ac);
+}
 
+// an empty queue counts its post-backoff down while the medium is idle; once it has elapsed the
+// next arrival draws a fresh backoff instead of reusing the old one
+void WiFi_AP::macPostBackoff(int q, simtime_t now)
+{
+    if((mac_backoff[q] < 0)||(mac_count_from[q] < 0))
+        return;                                     // nothing pending, or the medium is busy and the count is frozen
+    simtime_t aifs_end = mac_count_from[q] + sifs + edca[q % num_acs].aifsn*slot_time;
+    if(now <= aifs_end)
+        return;
+    mac_backoff[q] -= (int)floor((now - aifs_end).dbl()/slot_time + 1e-9);
+    if(mac_backoff[q] <= 0)
+        mac_backoff[q] = -1;
+}
 
+void WiFi_AP::macScheduleAccess()
+{
+    if(mac_tx_end->isScheduled())
+        return;                                     // backoffs are frozen while a PPDU is on the air
+    simtime_t next = -1;
+    for(int q = 0; q < stations*num_acs; q++) {
+        if(mac_queue[q]->isEmpty())
+            continue;
+        simtime_t ready = mac_count_from[q] + sifs + edca[q % num_acs].aifsn*slot_time + mac_backoff[q]*slot_time;
+        if((next < 0)||(ready < next))
+            next = ready;
+    }
+    cancelEvent(mac_access);
+    if(next >= 0)
+        scheduleAt(next, mac_access);
+}
 
+void WiFi_AP::macAccess()
+{
+    simtime_t now = simTime();
+    mac_tx.clear();
+    mac_tx_frames.clear();
+    vector<int> losers;                             // internal-collision losers, their new backoff is drawn after the freeze
+    for(int q = 0; q < stations*num_acs; q++) {
+        if((!mac_queue[q]->isEmpty())&&(mac_count_from[q] + sifs + edca[q % num_acs].aifsn*slot_time + mac_backoff[q]*slot_time <= now)) {
+            // internal collision: the higher access category of the same station keeps the TXOP
+            if((!mac_tx.empty())&&(mac_tx.back()/num_acs == q/num_acs)) {
+                int lower = mac_tx.back();
+                mac_tx.pop_back();
+                mac_retries[lower]++;
+                mac_cw[lower] = std::min(2*mac_cw[lower] + 1, edca[lower % num_acs].cwmax);
+                losers.push_back(lower);
+            }
+            mac_tx.push_back(q);
+        }
+    }
+    if(mac_tx.empty()) {
+        macScheduleAccess();
+        return;
+    }
+    for(int q = 0; q < stations*num_acs; q++) {
+        // the others freeze their backoff for the duration of the PPDU
+        simtime_t aifs_end = mac_count_from[q] + sifs + edca[q % num_acs].aifsn*slot_time;
+        if((!mac_queue[q]->isEmpty())&&(std::find(mac_tx.begin(), mac_tx.end(), q) == mac_tx.end())&&(now > aifs_end)) {
+            mac_backoff[q] = std::max(0, mac_backoff[q] - (int)floor((now - aifs_end).dbl()/slot_time + 1e-9));
+        }
+        if(mac_queue[q]->isEmpty())
+            macPostBackoff(q, now);
+        mac_count_from[q] = -1;
+    }
+    for(int q : losers) {
+        mac_backoff[q] = intuniform(0, mac_cw[q], rng_wifi);   // counted from the end of this PPDU, not shortened by the freeze
+    }
 
+    double ppdu_max = 0;
+    for(int q : mac_tx) {
+        // A-MPDU from the head of the queue; the AP aggregates only frames for the device of the first one
+        cQueue *queue = mac_queue[q];
+        ethPacket *head = check_and_cast<ethPacket *>(queue->front());
+        int dest = (q/num_acs == stations - 1) ? dlDevice(head) : -1;
+        double air = 0;
+        int frames = 0;
+        for(cQueue::Iterator it(*queue); !it.end(); ++it) {
+            ethPacket *pkt = check_and_cast<ethPacket *>(*it);
+            if((frames == max_ampdu_frames)||((frames > 0)&&(air + frameAirtime(pkt) > edca[q % num_acs].txop)))
+                break;
+            if((dest >= 0)&&(dlDevice(pkt) != dest))
+                break;
+            air += frameAirtime(pkt);
+            frames++;
+        }
+        mac_tx_frames.push_back(frames);
+        ppdu_max = std::max(ppdu_max, phy_overhead + air + ack_time);
+    }
+    mac_busy += ppdu_max;
+    scheduleAt(now + ppdu_max, mac_tx_end);
+}
+
+void WiFi_AP::macTxEnd()
+{
+    simtime_t now = simTime();
+    if(mac_tx.size() == 1) {
+        int q = mac_tx[0];
+        for(int i = 0; i < mac_tx_frames[0]; i++) {
+            macDeliver((ethPacket *)mac_queue[q]->pop(), q/num_acs, q % num_acs);
+        }
+        mac_ampdus++;
+        mac_frames += mac_tx_frames[0];
+        mac_retries[q] = 0;
+        mac_cw[q] = edca[q % num_acs].cwmin;
+        mac_backoff[q] = intuniform(0, mac_cw[q], rng_wifi);     // post-backoff
+    }
+    else {
+        mac_collisions++;
+        for(size_t i = 0; i < mac_tx.size(); i++) {
+            int q = mac_tx[i];
+            if(++mac_retries[q] > retry_limit) {
+                for(int j = 0; j < mac_tx_frames[i]; j++) {
+                    delete mac_queue[q]->pop();
+                }
+                mac_drops += mac_tx_frames[i];
+                mac_retries[q] = 0;
+                mac_cw[q] = edca[q % num_acs].cwmin;
+            }
+            else {
+                mac_cw[q] = std::min(2*mac_cw[q] + 1, edca[q % num_acs].cwmax);
+            }
+            mac_backoff[q] = intuniform(0, mac_cw[q], rng_wifi);
+        }
+    }
+    mac_tx.clear();
+    for(int q = 0; q < stations*num_acs; q++) {
+        mac_count_from[q] = now;                    // medium idle again, every queue waits its AIFS
+    }
+    macScheduleAccess();
+}
+
+void WiFi_AP::macDeliver(ethPacket *pkt, int st, int ac)
+{
+    simtime_t done = (mac_mode == MAC_ANALYTICAL) ? mac_burst_end[st*num_acs + ac] : simTime();
+    mac_delay_sum[ac] += (done - pkt->getArrivalTime()).dbl();
+    mac_delay_count[ac]++;
+    if(st == stations - 1) {
+        sendDelayed(pkt, done - simTime(), dl_gate[dlDevice(pkt)]);
+    }
+    else {
+        pkt->setWapArrivalTime(done);               // received once the A-MPDU carrying it has ended
+        sendDelayed(pkt, done - simTime(), "Sfu_out");
+        pkt->setWapDepartureTime(done);
+    }
+}
+
+void WiFi_AP::finish()
+{
+    recordScalar("numEvents", numEvents);
+    FTTR_PROFILE_DUMP();
+    if(mac_mode != MAC_NONE) {
+        recordScalar("macAmpdus", mac_ampdus);
+        recordScalar("macMeanAmpduFrames", mac_ampdus > 0 ? (double)mac_frames/mac_ampdus : 0);
+        recordScalar("macCollisions", mac_collisions);
+        recordScalar("macDrops", mac_drops);
+        if(simTime() > 0)
+            recordScalar("macAirtimeUtilisation", mac_busy/simTime().dbl());
+        for(int ac = 0; ac < num_acs; ac++) {
+            if(mac_delay_count[ac] > 0)
+                recordScalar((string("macDelay ") + ac_names[ac]).c_str(), mac_delay_sum[ac]/mac_delay_count[ac], "s");
+        }
+    }
+}
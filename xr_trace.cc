@@ -0,0 +1,70 @@
+/*
+ * xr_trace.cc
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omnetpp.h>
+
+#include "xr_trace.h"
+
+using namespace omnetpp;
+
+std::map<std::string, XrTrace *> XrTrace::registry;
+
+XrTrace *XrTrace::acquire(const std::string &path)
+{
+    auto it = registry.find(path);
+    if(it != registry.end()) {
+        it->second->refs++;
+        return it->second;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw cRuntimeError("cannot open XR trace '%s'", path.c_str());
+    struct stat st;
+    fstat(fd, &st);
+    if((size_t)st.st_size < 16) {
+        close(fd);
+        throw cRuntimeError("XR trace '%s' is too short", path.c_str());
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);                                  // the mapping stays valid without the descriptor
+    if(map == MAP_FAILED)
+        throw cRuntimeError("cannot map XR trace '%s'", path.c_str());
+
+    const char *base = (const char *)map;
+    uint64_t count;
+    memcpy(&count, base + 8, 8);
+    if(memcmp(base, "FTTRXRT1", 8) != 0 || count == 0 || 16 + count*sizeof(XrTraceFrame) > (uint64_t)st.st_size) {
+        munmap(map, st.st_size);
+        throw cRuntimeError("'%s' is not a valid XR trace", path.c_str());
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);  // frames are streamed, read-ahead and early reclaim
+
+    XrTrace *trace = new XrTrace();
+    trace->path = path;
+    trace->map = map;
+    trace->mapLength = st.st_size;
+    trace->frames = (const XrTraceFrame *)(base + 16);
+    trace->count = count;
+    trace->refs = 1;
+    registry[path] = trace;
+    return trace;
+}
+
+void XrTrace::release(XrTrace *trace)
+{
+    if(trace == nullptr || --trace->refs > 0)
+        return;
+    registry.erase(trace->path);
+    munmap(trace->map, trace->mapLength);
+    delete trace;
+}
@@ -0,0 +1,52 @@
+/*
+ * xr_trace.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: mondals
+ */
+
+#ifndef XR_TRACE_H_
+#define XR_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+
+/*
+ * Read-only memory mapping of a recorded XR encoder trace (written by tools/xr_trace_convert.py).
+ * Every XR device replaying the same file shares one mapping through acquire()/release(), so
+ * only the pages that are actually read are resident, once, however many headsets replay it.
+ *
+ * file:   "FTTRXRT1" | uint64 frames | frames x XrTraceFrame
+ */
+struct XrTraceFrame
+{
+    double time;                                // encoder timestamp (s)
+    uint32_t size;                              // frame size (bytes)
+    uint8_t type;                               // 0 = P-frame, 1 = I-frame
+    uint8_t pad[3];
+};
+
+class XrTrace
+{
+    private:
+        std::string path;
+        void *map = nullptr;
+        size_t mapLength = 0;
+        const XrTraceFrame *frames = nullptr;
+        size_t count = 0;
+        int refs = 0;
+
+        static std::map<std::string, XrTrace *> registry;
+
+    public:
+        static XrTrace *acquire(const std::string &path);
+        static void release(XrTrace *trace);
+
+        size_t getFrames() const { return count; }
+        const XrTraceFrame &getFrame(size_t i) const { return frames[i]; }
+        double getDuration() const { return count > 1 ? frames[count-1].time - frames[0].time : 0; }
+};
+
+#endif /* XR_TRACE_H_ */